@@ -0,0 +1,269 @@
+// FontBaker - offline generator for TerminalX/Assets/Font/Terminal_atlas.h
+//
+// Rasterizes the printable ASCII glyph set with SSFN exactly as GlyphCache does
+// at runtime, packs the glyph rects into the smallest power-of-two A8 atlas, swizzles it
+// for the Xbox GPU and writes the texels plus the glyph rect table as a C header.
+//
+// Build and run on the host (see runme.bat):
+//   cl /O2 /EHsc FontBaker.cpp        or        g++ -O2 -o FontBaker FontBaker.cpp
+//   FontBaker ..\TerminalX\Assets\Font\Terminal_atlas.h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#define SSFN_IMPLEMENTATION
+#define SSFN_memcmp memcmp
+#define SSFN_memset memset
+#define SSFN_realloc realloc
+#define SSFN_free free
+#include "../TerminalX/ssfn.h"
+#include "../TerminalX/Assets/Font/Terminal_sfn.h"
+
+/* Must match the SSFN settings in GlyphCache.cpp */
+#define FONT_NAME "CascadiaCode"
+#define FONT_SIZE 32
+#define CANVAS_DIMENSION 1024
+#define GLYPH_PADDING 2
+#define ATLAS_MAX_DIMENSION 1024
+
+struct Glyph
+{
+    uint32_t unicode;
+    int srcX;
+    int srcY;
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+static bool TallerFirst(const Glyph* a, const Glyph* b)
+{
+    if (a->height != b->height)
+    {
+        return a->height > b->height;
+    }
+    return a->unicode < b->unicode;
+}
+
+/* Shelf-pack every glyph into width x height; returns false if they do not fit. */
+static bool Pack(std::vector<Glyph>& glyphs, int width, int height)
+{
+    std::vector<Glyph*> order;
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        order.push_back(&glyphs[i]);
+    }
+    std::sort(order.begin(), order.end(), TallerFirst);
+
+    int x = GLYPH_PADDING;
+    int y = GLYPH_PADDING;
+    int shelfHeight = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        Glyph* g = order[i];
+        if (x + g->width + GLYPH_PADDING > width)
+        {
+            x = GLYPH_PADDING;
+            y += shelfHeight + GLYPH_PADDING;
+            shelfHeight = 0;
+        }
+        if (x + g->width + GLYPH_PADDING > width || y + g->height + GLYPH_PADDING > height)
+        {
+            return false;
+        }
+        g->x = x;
+        g->y = y;
+        x += g->width + GLYPH_PADDING;
+        if (g->height > shelfHeight)
+        {
+            shelfHeight = g->height;
+        }
+    }
+    return true;
+}
+
+/* Same addressing as Swizzler::Swizzle (TerminalX/Swizzler.cpp) */
+static void Swizzle(const uint8_t* src, uint32_t depth, uint32_t width, uint32_t height, uint8_t* dest)
+{
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t sy = 0;
+        if (y < width)
+        {
+            for (int bit = 0; bit < 16; bit++)
+                sy |= ((y >> bit) & 1) << (2 * bit);
+            sy <<= 1;
+        }
+        else
+        {
+            uint32_t y_mask = y % width;
+            for (int bit = 0; bit < 16; bit++)
+                sy |= ((y_mask >> bit) & 1) << (2 * bit);
+            sy <<= 1;
+            sy += (y / width) * width * width;
+        }
+        const uint8_t* s = src + y * width * depth;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint32_t sx = 0;
+            if (x < height * 2)
+            {
+                for (int bit = 0; bit < 16; bit++)
+                    sx |= ((x >> bit) & 1) << (2 * bit);
+            }
+            else
+            {
+                uint32_t x_mask = x % (2 * height);
+                for (int bit = 0; bit < 16; bit++)
+                    sx |= ((x_mask >> bit) & 1) << (2 * bit);
+                sx += (x / (2 * height)) * 2 * height * height;
+            }
+            uint8_t* d = dest + (sx + sy) * depth;
+            for (uint32_t i = 0; i < depth; ++i)
+                *d++ = *s++;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* outPath = (argc > 1) ? argv[1] : "Terminal_atlas.h";
+
+    ssfn_t* ctx = (ssfn_t*)calloc(1, sizeof(ssfn_t));
+    if (ctx == NULL || ssfn_load(ctx, &terminal_sfn[0]) != 0)
+    {
+        fprintf(stderr, "Failed to load font\n");
+        return 1;
+    }
+    ssfn_select(ctx, SSFN_FAMILY_ANY, FONT_NAME, SSFN_STYLE_REGULAR, FONT_SIZE);
+
+    /* Render onto a canvas laid out like the runtime atlas so every glyph gets identical pixels */
+    std::vector<uint32_t> canvas((size_t)CANVAS_DIMENSION * CANVAS_DIMENSION, 0);
+    std::vector<Glyph> glyphs;
+    int x = GLYPH_PADDING;
+    int y = GLYPH_PADDING;
+    for (uint32_t unicode = 32; unicode < 127; unicode++)
+    {
+        char str[2] = { (char)unicode, 0 };
+        int boundsX;
+        int boundsY;
+        int boundsWidth;
+        int boundsHeight;
+        if (ssfn_bbox(ctx, str, &boundsWidth, &boundsHeight, &boundsX, &boundsY) != 0)
+        {
+            continue;
+        }
+        if ((x + boundsWidth + GLYPH_PADDING) > CANVAS_DIMENSION)
+        {
+            x = GLYPH_PADDING;
+            y = y + boundsHeight + GLYPH_PADDING;
+        }
+
+        ssfn_buf_t buffer;
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.ptr = (uint8_t*)&canvas[0];
+        buffer.x = x + boundsX;
+        buffer.y = y + boundsY;
+        buffer.w = CANVAS_DIMENSION;
+        buffer.h = CANVAS_DIMENSION;
+        buffer.p = CANVAS_DIMENSION * 4;
+        buffer.bg = 0;
+        buffer.fg = 0xffffffff;
+        ssfn_render(ctx, &buffer, str);
+
+        Glyph g;
+        g.unicode = unicode;
+        g.srcX = x;
+        g.srcY = y;
+        g.x = 0;
+        g.y = 0;
+        g.width = boundsWidth;
+        g.height = boundsHeight;
+        glyphs.push_back(g);
+        x = x + boundsWidth + GLYPH_PADDING;
+    }
+
+    /* Smallest power-of-two atlas (square, or twice as wide as tall) that holds every glyph */
+    int atlasWidth = 0;
+    int atlasHeight = 0;
+    for (int dim = 32; dim <= ATLAS_MAX_DIMENSION && atlasWidth == 0; dim *= 2)
+    {
+        if (Pack(glyphs, dim, dim / 2))
+        {
+            atlasWidth = dim;
+            atlasHeight = dim / 2;
+        }
+        else if (Pack(glyphs, dim, dim))
+        {
+            atlasWidth = dim;
+            atlasHeight = dim;
+        }
+    }
+    if (atlasWidth == 0)
+    {
+        fprintf(stderr, "Glyphs do not fit in %dx%d\n", ATLAS_MAX_DIMENSION, ATLAS_MAX_DIMENSION);
+        return 1;
+    }
+
+    /* Coverage lives in the alpha channel of the rendered ARGB pixels */
+    std::vector<uint8_t> linear((size_t)atlasWidth * atlasHeight, 0);
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        const Glyph& g = glyphs[i];
+        for (int row = 0; row < g.height; row++)
+        {
+            for (int col = 0; col < g.width; col++)
+            {
+                uint32_t argb = canvas[(size_t)(g.srcY + row) * CANVAS_DIMENSION + g.srcX + col];
+                linear[(size_t)(g.y + row) * atlasWidth + g.x + col] = (uint8_t)(argb >> 24);
+            }
+        }
+    }
+    std::vector<uint8_t> swizzled(linear.size(), 0);
+    Swizzle(&linear[0], 1, (uint32_t)atlasWidth, (uint32_t)atlasHeight, &swizzled[0]);
+
+    FILE* out = fopen(outPath, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "Cannot write %s\n", outPath);
+        return 1;
+    }
+    fprintf(out, "#pragma once\n\n");
+    fprintf(out, "// Generated by FontBaker from Terminal_sfn.h (%s, size %d). Do not edit.\n\n", FONT_NAME, FONT_SIZE);
+    fprintf(out, "#define TERMINAL_ATLAS_WIDTH %d\n", atlasWidth);
+    fprintf(out, "#define TERMINAL_ATLAS_HEIGHT %d\n", atlasHeight);
+    fprintf(out, "#define TERMINAL_ATLAS_GLYPHS %d\n\n", (int)glyphs.size());
+    fprintf(out, "// unicode, x, y, width, height\n");
+    fprintf(out, "const unsigned short terminal_atlas_rects[TERMINAL_ATLAS_GLYPHS][5] = {\n");
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        const Glyph& g = glyphs[i];
+        fprintf(out, "    { 0x%02x, %d, %d, %d, %d },\n", g.unicode, g.x, g.y, g.width, g.height);
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "// A8 texels, pre-swizzled\n");
+    fprintf(out, "const uint8_t terminal_atlas[]  = {\n");
+    for (size_t i = 0; i < swizzled.size(); i++)
+    {
+        if ((i % 16) == 0)
+        {
+            fprintf(out, "    ");
+        }
+        fprintf(out, "0x%02x, ", swizzled[i]);
+        if ((i % 16) == 15)
+        {
+            fprintf(out, "\n");
+        }
+    }
+    fprintf(out, "};\n");
+    fclose(out);
+
+    printf("%s: %d glyphs, %dx%d A8 atlas (%d bytes)\n", outPath, (int)glyphs.size(), atlasWidth, atlasHeight, atlasWidth * atlasHeight);
+    free(ctx);
+    return 0;
+}
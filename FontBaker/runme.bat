@@ -0,0 +1,2 @@
+cl /nologo /O2 /EHsc FontBaker.cpp
+FontBaker ..\TerminalX\Assets\Font\Terminal_atlas.h
@@ -0,0 +1,164 @@
+// CRC32Test - host check and benchmark for TerminalX/CRC32.cpp
+//
+// Checks the slice-by-8 kernel against a bitwise CRC-32 at every buffer alignment, for
+// every length up to a few slices past the word loop, and through chunked CRC32::Update
+// calls. Then it times the kernel against the byte-at-a-time table loop it replaced.
+//
+// Build and run on the host (see runme.bat):
+//   cl /nologo /O2 /EHsc /IShim CRC32Test.cpp ..\TerminalX\CRC32.cpp
+//   g++ -O2 -IShim -o CRC32Test CRC32Test.cpp ../TerminalX/CRC32.cpp
+
+#include "../TerminalX/CRC32.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#define TEST_BUFFER_SIZE (1024 * 1024)
+#define TEST_MAX_ALIGNMENT 16
+#define TEST_MAX_LENGTH 300
+#define TEST_CHUNKED_RUNS 200
+#define BENCH_PASSES 64
+
+static uint32_t s_byteTable[256];
+
+static uint32_t ReferenceBitwise(const uint8_t* buffer, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= buffer[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+/* The byte-at-a-time table loop CRC32::Calculate used before slice-by-8 */
+static uint32_t ReferenceByteTable(const uint8_t* buffer, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (size--)
+    {
+        crc = (crc >> 8) ^ s_byteTable[(crc & 0xFF) ^ *buffer++];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void BuildByteTable()
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+        s_byteTable[i] = crc;
+    }
+}
+
+static uint32_t s_seed = 12345;
+
+static uint32_t NextRandom()
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return (s_seed >> 16) & 0x7FFF;
+}
+
+static double Seconds(clock_t start)
+{
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return (seconds > 0.0) ? seconds : 1e-6;
+}
+
+int main()
+{
+    BuildByteTable();
+    std::vector<uint8_t> data(TEST_BUFFER_SIZE + TEST_MAX_ALIGNMENT);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = (uint8_t)NextRandom();
+    }
+    int failures = 0;
+
+    const char* check = "123456789";
+    if (CRC32::Calculate((const uint8_t*)check, 9) != 0xCBF43926)
+    {
+        printf("FAIL: check value of \"123456789\" is %08X, expected CBF43926\n", (unsigned int)CRC32::Calculate((const uint8_t*)check, 9));
+        failures++;
+    }
+
+    for (int alignment = 0; alignment < TEST_MAX_ALIGNMENT; alignment++)
+    {
+        for (int length = 0; length <= TEST_MAX_LENGTH; length++)
+        {
+            const uint8_t* p = &data[alignment];
+            uint32_t expected = ReferenceBitwise(p, length);
+            uint32_t actual = CRC32::Calculate(p, (uint32_t)length);
+            if (actual != expected)
+            {
+                if (failures < 10)
+                {
+                    printf("FAIL: alignment %d length %d: %08X, expected %08X\n", alignment, length, (unsigned int)actual, (unsigned int)expected);
+                }
+                failures++;
+            }
+        }
+    }
+
+    uint32_t whole = ReferenceBitwise(&data[0], TEST_BUFFER_SIZE);
+    for (int run = 0; run < TEST_CHUNKED_RUNS; run++)
+    {
+        uint32_t crc = 0;
+        size_t done = 0;
+        while (done < TEST_BUFFER_SIZE)
+        {
+            /* Mostly odd-sized chunks so every later chunk starts misaligned */
+            size_t piece = (run % 2 == 0) ? 1 + NextRandom() % 97 : 1 + NextRandom() * 3;
+            if (piece > TEST_BUFFER_SIZE - done)
+            {
+                piece = TEST_BUFFER_SIZE - done;
+            }
+            crc = CRC32::Update(crc, &data[done], (uint32_t)piece);
+            done += piece;
+        }
+        if (crc != whole)
+        {
+            if (failures < 10)
+            {
+                printf("FAIL: chunked run %d: %08X, expected %08X\n", run, (unsigned int)crc, (unsigned int)whole);
+            }
+            failures++;
+        }
+    }
+
+    if (failures != 0)
+    {
+        printf("CRC32Test: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("CRC32Test: bit-exact at %d alignments x %d lengths and %d chunked runs\n", TEST_MAX_ALIGNMENT, TEST_MAX_LENGTH + 1, TEST_CHUNKED_RUNS);
+
+    double megabytes = (double)BENCH_PASSES * TEST_BUFFER_SIZE / (1024.0 * 1024.0);
+    volatile uint32_t sink = 0;
+    clock_t start = clock();
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        sink ^= ReferenceByteTable(&data[pass % 8], TEST_BUFFER_SIZE);
+    }
+    double byteSeconds = Seconds(start);
+    start = clock();
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        sink ^= CRC32::Calculate(&data[pass % 8], TEST_BUFFER_SIZE);
+    }
+    double sliceSeconds = Seconds(start);
+    printf("byte table:  %.0f MB in %.3f s, %.1f MB/s\n", megabytes, byteSeconds, megabytes / byteSeconds);
+    printf("slice-by-8:  %.0f MB in %.3f s, %.1f MB/s (%.1fx)\n", megabytes, sliceSeconds, megabytes / sliceSeconds, byteSeconds / sliceSeconds);
+    return 0;
+}
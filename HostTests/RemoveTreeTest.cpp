@@ -0,0 +1,410 @@
+// RemoveTreeTest - host test for DirTree::Remove (TerminalX/DirTree.cpp), the RD /S and MOVE tree remover
+//
+// Runs the remover against an in-memory volume: DirEnumerator, DeleteFileA, RemoveDirectoryA and
+// friends are implemented below over a node tree. A 10,000-deep chain of directories, each holding
+// a file, must come out completely. At most one listing may be open at any time, and the remover's
+// stack must not grow with depth. Wide directories exercise the file batches, and read-only files
+// and removeFiles=false must stop with the shell's messages.
+//
+// Build and run on the host (see runme.bat):
+//   cl /nologo /O2 /EHsc /IShim RemoveTreeTest.cpp ..\TerminalX\DirTree.cpp ..\TerminalX\StatCache.cpp ..\TerminalX\String.cpp ..\TerminalX\Debug.cpp
+//   g++ -O2 -IShim -o RemoveTreeTest RemoveTreeTest.cpp ../TerminalX/DirTree.cpp ../TerminalX/StatCache.cpp ../TerminalX/String.cpp ../TerminalX/Debug.cpp
+
+#include "../TerminalX/DirTree.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define DEEP_TREE_DEPTH 10000
+#define WIDE_TREE_DIRS 3
+#define WIDE_TREE_FILES 1000
+#define MAX_STACK_BYTES (16 * 1024)
+
+/* ---- In-memory volume "T:" ---- */
+
+struct FakeNode
+{
+    std::string name;
+    bool isDir;
+    DWORD attributes;
+    FakeNode* parent;
+    std::vector<FakeNode*> children;
+};
+
+static FakeNode s_root;
+static unsigned long s_removedDirs = 0;
+static unsigned long s_deletedFiles = 0;
+static int s_openListings = 0;
+static int s_maxOpenListings = 0;
+static char* s_stackBase = NULL;
+static size_t s_maxStackBytes = 0;
+
+static bool NameEquals(const std::string& name, const char* part, size_t length)
+{
+    if (name.length() != length)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        if (toupper((unsigned char)name[i]) != toupper((unsigned char)part[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static FakeNode* FindChild(FakeNode* dir, const char* part, size_t length)
+{
+    for (size_t i = 0; i < dir->children.size(); i++)
+    {
+        if (NameEquals(dir->children[i]->name, part, length))
+        {
+            return dir->children[i];
+        }
+    }
+    return NULL;
+}
+
+/** Resolve "T:\a\b"; sets the last error the way Win32 does when it fails. */
+static FakeNode* Resolve(const char* path)
+{
+    if (toupper((unsigned char)path[0]) != 'T' || path[1] != ':')
+    {
+        SetLastError(ERROR_PATH_NOT_FOUND);
+        return NULL;
+    }
+    FakeNode* node = &s_root;
+    const char* p = path + 2;
+    while (*p == '\\')
+    {
+        p++;
+    }
+    while (*p != 0)
+    {
+        const char* end = p;
+        while (*end != 0 && *end != '\\')
+        {
+            end++;
+        }
+        FakeNode* child = node->isDir ? FindChild(node, p, (size_t)(end - p)) : NULL;
+        if (child == NULL)
+        {
+            SetLastError(*end == 0 ? ERROR_FILE_NOT_FOUND : ERROR_PATH_NOT_FOUND);
+            return NULL;
+        }
+        node = child;
+        p = end;
+        while (*p == '\\')
+        {
+            p++;
+        }
+    }
+    return node;
+}
+
+static FakeNode* AddNode(FakeNode* parent, const std::string& name, bool isDir, DWORD attributes)
+{
+    FakeNode* node = new FakeNode();
+    node->name = name;
+    node->isDir = isDir;
+    node->attributes = attributes | (isDir ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE);
+    node->parent = parent;
+    parent->children.push_back(node);
+    return node;
+}
+
+static void Unlink(FakeNode* node)
+{
+    std::vector<FakeNode*>& siblings = node->parent->children;
+    for (size_t i = 0; i < siblings.size(); i++)
+    {
+        if (siblings[i] == node)
+        {
+            siblings.erase(siblings.begin() + i);
+            break;
+        }
+    }
+    delete node;
+}
+
+DWORD GetFileAttributesA(const char* path)
+{
+    FakeNode* node = Resolve(path);
+    return (node != NULL) ? node->attributes : INVALID_FILE_ATTRIBUTES;
+}
+
+BOOL SetFileAttributesA(const char* path, DWORD attributes)
+{
+    FakeNode* node = Resolve(path);
+    if (node == NULL)
+    {
+        return FALSE;
+    }
+    node->attributes = (attributes & ~FILE_ATTRIBUTE_DIRECTORY) | (node->isDir ? FILE_ATTRIBUTE_DIRECTORY : 0);
+    return TRUE;
+}
+
+BOOL DeleteFileA(const char* path)
+{
+    FakeNode* node = Resolve(path);
+    if (node == NULL)
+    {
+        return FALSE;
+    }
+    if (node->isDir || (node->attributes & FILE_ATTRIBUTE_READONLY) != 0)
+    {
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+    Unlink(node);
+    s_deletedFiles++;
+    return TRUE;
+}
+
+BOOL RemoveDirectoryA(const char* path)
+{
+    FakeNode* node = Resolve(path);
+    if (node == NULL)
+    {
+        return FALSE;
+    }
+    if (!node->isDir || node == &s_root)
+    {
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+    if (!node->children.empty())
+    {
+        SetLastError(ERROR_DIR_NOT_EMPTY);
+        return FALSE;
+    }
+    Unlink(node);
+    s_removedDirs++;
+    return TRUE;
+}
+
+/* ---- DirEnumerator over the volume: a listing is a snapshot taken at Open ---- */
+
+struct FakeListing
+{
+    std::vector<std::string> names;
+    std::vector<DWORD> attributes;
+};
+
+static std::map<const DirEnumerator*, FakeListing> s_listings;
+
+DirEnumerator::DirEnumerator()
+    : mHandle(NULL), mBuffer(NULL), mBufferUsed(0), mOffset(0), mFirstBatch(true), mDone(true), mNotFound(false)
+{
+    mName[0] = 0;
+}
+
+DirEnumerator::~DirEnumerator()
+{
+    Close();
+}
+
+bool DirEnumerator::Open(const std::string& apiPath)
+{
+    Close();
+    char marker;
+    if (s_stackBase == NULL)
+    {
+        s_stackBase = &marker;
+    }
+    size_t used = (s_stackBase > &marker) ? (size_t)(s_stackBase - &marker) : (size_t)(&marker - s_stackBase);
+    if (used > s_maxStackBytes)
+    {
+        s_maxStackBytes = used;
+    }
+
+    FakeNode* node = Resolve(apiPath.c_str());
+    mNotFound = (node == NULL);
+    if (node == NULL || !node->isDir)
+    {
+        return false;
+    }
+    FakeListing& listing = s_listings[this];
+    for (size_t i = 0; i < node->children.size(); i++)
+    {
+        listing.names.push_back(node->children[i]->name);
+        listing.attributes.push_back(node->children[i]->attributes);
+    }
+    mOffset = 0;
+    mDone = false;
+    mHandle = (HANDLE)this;
+    s_openListings++;
+    if (s_openListings > s_maxOpenListings)
+    {
+        s_maxOpenListings = s_openListings;
+    }
+    return true;
+}
+
+bool DirEnumerator::Next(DirEnumEntry& entry)
+{
+    if (mDone)
+    {
+        return false;
+    }
+    FakeListing& listing = s_listings[this];
+    if (mOffset >= listing.names.size())
+    {
+        mDone = true;
+        return false;
+    }
+    const std::string& name = listing.names[mOffset];
+    entry.name = name.c_str();
+    entry.nameLength = name.length();
+    entry.attributes = listing.attributes[mOffset];
+    entry.isDir = (entry.attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    entry.size = 0;
+    entry.lastWriteTime.dwLowDateTime = 0;
+    entry.lastWriteTime.dwHighDateTime = 0;
+    mOffset++;
+    return true;
+}
+
+void DirEnumerator::Close()
+{
+    if (mHandle != NULL)
+    {
+        s_listings.erase(this);
+        s_openListings--;
+        mHandle = NULL;
+    }
+    mDone = true;
+}
+
+bool DirEnumerator::WasNotFound() const
+{
+    return mNotFound;
+}
+
+/* ---- Tests ---- */
+
+class CountingSink : public OutputSink
+{
+public:
+    CountingSink() : mWrites(0) {}
+    using OutputSink::Write;
+    virtual void Write(const char* text, size_t length)
+    {
+        mWrites++;
+        mLast.assign(text, length);
+    }
+    unsigned long mWrites;
+    std::string mLast;
+};
+
+static int s_failures = 0;
+
+static void Expect(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void ResetCounters()
+{
+    s_removedDirs = 0;
+    s_deletedFiles = 0;
+    s_maxOpenListings = 0;
+    s_stackBase = NULL;
+    s_maxStackBytes = 0;
+}
+
+static void TestDeepTree()
+{
+    ResetCounters();
+    FakeNode* dir = AddNode(&s_root, "deep", true, 0);
+    for (int depth = 0; depth < DEEP_TREE_DEPTH; depth++)
+    {
+        AddNode(dir, "f.txt", false, 0);
+        dir = AddNode(dir, "d", true, 0);
+    }
+    AddNode(&s_root, "keep", true, 0);
+
+    CountingSink sink;
+    clock_t start = clock();
+    std::string result = DirTree::Remove("T:\\deep", true, &sink);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    Expect(result.empty(), "deep tree: Remove returned an error");
+    Expect(Resolve("T:\\deep") == NULL, "deep tree: root still exists");
+    Expect(Resolve("T:\\keep") != NULL, "deep tree: sibling was removed");
+    Expect(s_removedDirs == DEEP_TREE_DEPTH + 1, "deep tree: wrong directory count");
+    Expect(s_deletedFiles == DEEP_TREE_DEPTH, "deep tree: wrong file count");
+    Expect(s_maxOpenListings == 1, "deep tree: more than one listing open at once");
+    Expect(s_maxStackBytes < MAX_STACK_BYTES, "deep tree: stack grew with depth");
+    Expect(sink.mWrites == 0 || sink.mLast == "\n", "deep tree: progress line not ended");
+    printf("deep tree: %d levels, %lu dirs and %lu files removed in %.2f s, %d listing(s) open at most, %lu bytes of stack between listings\n",
+        DEEP_TREE_DEPTH, s_removedDirs, s_deletedFiles, seconds, s_maxOpenListings, (unsigned long)s_maxStackBytes);
+}
+
+static void TestWideTree()
+{
+    ResetCounters();
+    FakeNode* wide = AddNode(&s_root, "wide", true, 0);
+    for (int d = 0; d < WIDE_TREE_DIRS; d++)
+    {
+        char name[16];
+        sprintf(name, "sub%d", d);
+        FakeNode* sub = AddNode(wide, name, true, 0);
+        for (int f = 0; f < WIDE_TREE_FILES; f++)
+        {
+            sprintf(name, "file%04d.bin", f);
+            AddNode(sub, name, false, 0);
+            AddNode(wide, std::string("top") + name, false, 0);
+        }
+    }
+    std::string result = DirTree::Remove("T:\\wide", true, NULL);
+    Expect(result.empty(), "wide tree: Remove returned an error");
+    Expect(Resolve("T:\\wide") == NULL, "wide tree: root still exists");
+    Expect(s_deletedFiles == 2 * WIDE_TREE_DIRS * WIDE_TREE_FILES, "wide tree: wrong file count");
+    Expect(s_removedDirs == WIDE_TREE_DIRS + 1, "wide tree: wrong directory count");
+}
+
+static void TestStops()
+{
+    ResetCounters();
+    FakeNode* keep = AddNode(&s_root, "nofiles", true, 0);
+    AddNode(AddNode(AddNode(keep, "a", true, 0), "b", true, 0), "file.txt", false, 0);
+    std::string result = DirTree::Remove("T:\\nofiles", false, NULL);
+    Expect(result == "The directory is not empty.\n", "removeFiles=false: wrong message");
+    Expect(Resolve("T:\\nofiles\\a\\b\\file.txt") != NULL, "removeFiles=false: file was deleted");
+
+    FakeNode* locked = AddNode(&s_root, "locked", true, 0);
+    AddNode(locked, "ro.txt", false, FILE_ATTRIBUTE_READONLY);
+    result = DirTree::Remove("T:\\locked", true, NULL);
+    Expect(result == "Unable to delete file.\n", "read-only file: wrong message");
+    Expect(Resolve("T:\\locked") != NULL, "read-only file: directory was removed");
+}
+
+int main()
+{
+    s_root.isDir = true;
+    s_root.attributes = FILE_ATTRIBUTE_DIRECTORY;
+    s_root.parent = NULL;
+
+    TestDeepTree();
+    TestWideTree();
+    TestStops();
+
+    if (s_failures != 0)
+    {
+        printf("RemoveTreeTest: %d failure(s)\n", s_failures);
+        return 1;
+    }
+    printf("RemoveTreeTest: OK\n");
+    return 0;
+}
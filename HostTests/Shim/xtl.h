@@ -0,0 +1,104 @@
+#pragma once
+
+// Host stand-in for the Xbox SDK's <xtl.h>, just large enough to compile the TerminalX
+// modules that HostTests exercise. File system calls are only declared here; each test
+// implements the ones it needs against its own in-memory volume.
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _MSC_VER
+#define __int64 long long
+#define _vsnprintf vsnprintf
+#endif
+
+#define WINAPI
+#define VOID void
+#define IN
+#define OUT
+#define TRUE 1
+#define FALSE 0
+
+typedef int BOOL;
+typedef unsigned char BOOLEAN;
+typedef unsigned char UCHAR;
+typedef char CHAR;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef intptr_t LONG_PTR;
+typedef char* PSTR;
+typedef void* PVOID;
+typedef void* HANDLE;
+typedef HANDLE* PHANDLE;
+typedef uint32_t ACCESS_MASK;
+
+typedef union LARGE_INTEGER
+{
+    struct
+    {
+        DWORD LowPart;
+        LONG HighPart;
+    };
+    long long QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct FILETIME
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+#define INVALID_FILE_ATTRIBUTES 0xFFFFFFFF
+
+#define FILE_ATTRIBUTE_READONLY 0x00000001
+#define FILE_ATTRIBUTE_HIDDEN 0x00000002
+#define FILE_ATTRIBUTE_SYSTEM 0x00000004
+#define FILE_ATTRIBUTE_DIRECTORY 0x00000010
+#define FILE_ATTRIBUTE_ARCHIVE 0x00000020
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+
+#define NO_ERROR 0
+#define ERROR_SUCCESS 0
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_PATH_NOT_FOUND 3
+#define ERROR_ACCESS_DENIED 5
+#define ERROR_DIR_NOT_EMPTY 145
+
+inline DWORD& HostLastError()
+{
+    static DWORD error = NO_ERROR;
+    return error;
+}
+
+inline DWORD GetLastError()
+{
+    return HostLastError();
+}
+
+inline void SetLastError(DWORD error)
+{
+    HostLastError() = error;
+}
+
+inline DWORD GetTickCount()
+{
+    return (DWORD)((double)clock() * 1000.0 / CLOCKS_PER_SEC);
+}
+
+inline void OutputDebugStringA(const char* text)
+{
+    (void)text;
+}
+
+DWORD GetFileAttributesA(const char* path);
+BOOL SetFileAttributesA(const char* path, DWORD attributes);
+BOOL DeleteFileA(const char* path);
+BOOL RemoveDirectoryA(const char* path);
@@ -0,0 +1,4 @@
+cl /nologo /O2 /EHsc /IShim CRC32Test.cpp ..\TerminalX\CRC32.cpp || exit /b 1
+CRC32Test || exit /b 1
+cl /nologo /O2 /EHsc /IShim RemoveTreeTest.cpp ..\TerminalX\DirTree.cpp ..\TerminalX\StatCache.cpp ..\TerminalX\String.cpp ..\TerminalX\Debug.cpp || exit /b 1
+RemoveTreeTest || exit /b 1
@@ -0,0 +1,148 @@
+#include "BlockReader.h"
+
+#define BLOCK_READER_BLOCK_SIZE (1024 * 1024)
+
+BlockReader::BlockReader()
+    : mHandle(INVALID_HANDLE_VALUE), mBuffers(NULL), mSize(0), mBlockCount(0), mNextIssue(0), mNextDeliver(0), mError(false)
+{
+    mPending[0] = false;
+    mPending[1] = false;
+    memset(mOverlapped, 0, sizeof(mOverlapped));
+}
+
+BlockReader::~BlockReader()
+{
+    Close();
+}
+
+unsigned __int64 BlockReader::GetSize() const
+{
+    return mSize;
+}
+
+bool BlockReader::HadError() const
+{
+    return mError;
+}
+
+bool BlockReader::Next(const uint8_t*& data, DWORD& length)
+{
+    if (mError || mNextDeliver >= mBlockCount)
+    {
+        return false;
+    }
+    /* The caller is done with the previous block, so its buffer can take the next read */
+    if (mNextDeliver > 0 && mNextIssue < mBlockCount && !StartRead(mNextIssue++))
+    {
+        mError = true;
+        return false;
+    }
+
+    int slot = (int)(mNextDeliver % 2);
+    unsigned __int64 remaining = mSize - mNextDeliver * BLOCK_READER_BLOCK_SIZE;
+    DWORD expected = (remaining < BLOCK_READER_BLOCK_SIZE) ? (DWORD)remaining : BLOCK_READER_BLOCK_SIZE;
+    DWORD transferred = 0;
+    mPending[slot] = false;
+    if (!GetOverlappedResult(mHandle, &mOverlapped[slot], &transferred, TRUE))
+    {
+        transferred = 0;
+    }
+    if (transferred < expected)
+    {
+        mError = true;
+        return false;
+    }
+    data = mBuffers + slot * BLOCK_READER_BLOCK_SIZE;
+    length = expected;
+    mNextDeliver++;
+    return true;
+}
+
+bool BlockReader::Open(const std::string& apiPath)
+{
+    Close();
+    mHandle = CreateFileA(apiPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL);
+    if (mHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    DWORD sizeHigh = 0;
+    DWORD sizeLow = GetFileSize(mHandle, &sizeHigh);
+    if (sizeLow == 0xFFFFFFFF && GetLastError() != NO_ERROR)
+    {
+        Close();
+        return false;
+    }
+    mSize = ((unsigned __int64)sizeHigh << 32) | sizeLow;
+    mBlockCount = (mSize + BLOCK_READER_BLOCK_SIZE - 1) / BLOCK_READER_BLOCK_SIZE;
+    if (mBlockCount == 0)
+    {
+        return true;
+    }
+    mBuffers = (uint8_t*)VirtualAlloc(NULL, BLOCK_READER_BLOCK_SIZE * 2, MEM_COMMIT, PAGE_READWRITE);
+    mOverlapped[0].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    mOverlapped[1].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (mBuffers == NULL || mOverlapped[0].hEvent == NULL || mOverlapped[1].hEvent == NULL)
+    {
+        Close();
+        return false;
+    }
+    while (mNextIssue < mBlockCount && mNextIssue < 2)
+    {
+        if (!StartRead(mNextIssue++))
+        {
+            mError = true;
+            break;
+        }
+    }
+    return true;
+}
+
+bool BlockReader::StartRead(unsigned __int64 block)
+{
+    int slot = (int)(block % 2);
+    unsigned __int64 offset = block * BLOCK_READER_BLOCK_SIZE;
+    mOverlapped[slot].Offset = (DWORD)offset;
+    mOverlapped[slot].OffsetHigh = (DWORD)(offset >> 32);
+    DWORD done = 0;
+    if (!ReadFile(mHandle, mBuffers + slot * BLOCK_READER_BLOCK_SIZE, BLOCK_READER_BLOCK_SIZE, &done, &mOverlapped[slot]) && GetLastError() != ERROR_IO_PENDING)
+    {
+        return false;
+    }
+    mPending[slot] = true;
+    return true;
+}
+
+void BlockReader::Close()
+{
+    /* Never free a buffer the kernel may still be filling */
+    for (int i = 0; i < 2; i++)
+    {
+        if (mPending[i])
+        {
+            DWORD transferred = 0;
+            GetOverlappedResult(mHandle, &mOverlapped[i], &transferred, TRUE);
+            mPending[i] = false;
+        }
+        if (mOverlapped[i].hEvent != NULL)
+        {
+            CloseHandle(mOverlapped[i].hEvent);
+        }
+    }
+    memset(mOverlapped, 0, sizeof(mOverlapped));
+    if (mBuffers != NULL)
+    {
+        VirtualFree(mBuffers, 0, MEM_RELEASE);
+        mBuffers = NULL;
+    }
+    if (mHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mHandle);
+        mHandle = INVALID_HANDLE_VALUE;
+    }
+    mSize = 0;
+    mBlockCount = 0;
+    mNextIssue = 0;
+    mNextDeliver = 0;
+    mError = false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "External.h"
+
+#include <string>
+
+/** Reads a file front to back in 1 MB blocks with the next block's read already in flight, so the caller can process one block while the disk fetches the next. */
+class BlockReader
+{
+public:
+    BlockReader();
+    ~BlockReader();
+
+    /** Open an API path (e.g. "HDD0-E:\Games\default.xbe") and start reading. Returns false if it cannot be opened. */
+    bool Open(const std::string& apiPath);
+    /** Fetch the next block; data stays valid until the following call. Returns false at the end of the file or on error (see HadError). */
+    bool Next(const uint8_t*& data, DWORD& length);
+    void Close();
+    unsigned __int64 GetSize() const;
+    /** True if a read failed before the end of the file. */
+    bool HadError() const;
+
+private:
+    BlockReader(const BlockReader&);
+    BlockReader& operator=(const BlockReader&);
+
+    bool StartRead(unsigned __int64 block);
+
+    HANDLE mHandle;
+    uint8_t* mBuffers;          /* two blocks; block n lives in buffer n % 2 */
+    OVERLAPPED mOverlapped[2];
+    bool mPending[2];
+    unsigned __int64 mSize;
+    unsigned __int64 mBlockCount;
+    unsigned __int64 mNextIssue;    /* next block to start reading */
+    unsigned __int64 mNextDeliver;  /* next block to hand out */
+    bool mError;
+};
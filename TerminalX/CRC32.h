@@ -5,6 +5,8 @@
 class CRC32 {
   public:
     static uint32_t Calculate(const uint8_t* buffer, uint32_t size);
+    /** Continue a CRC over more data: pass 0 for the first chunk, then the previous result. Update(0, b, n) == Calculate(b, n). */
+    static uint32_t Update(uint32_t crc, const uint8_t* buffer, uint32_t size);
   private:
     static void Calculate(const uint8_t* buffer, uint32_t size, uint32_t& crc);
 };
@@ -3,6 +3,7 @@
 #include "Commands\ClsCommand.h"
 #include "Commands\ColorCommand.h"
 #include "Commands\CopyCommand.h"
+#include "Commands\CrcCommand.h"
 #include "Commands\DateCommand.h"
 #include "Commands\DelCommand.h"
 #include "Commands\EchoCommand.h"
@@ -17,9 +18,12 @@
 #include "Commands\CdCommand.h"
 #include "Commands\ExitCommand.h"
 #include "Commands\DriveCommand.h"
+#include "Commands\DrivesCommand.h"
 #include "Commands\ShutdownCommand.h"
 #include "Commands\LoginCommand.h"
 #include "Commands\EditCommand.h"
+#include "Commands\XcopyCommand.h"
+#include "StatCache.h"
 #include "String.h"
 #include <cctype>
 #include <string>
@@ -73,7 +77,7 @@ std::vector<std::string> CommandProcessor::ParseLine(const std::string& line)
     return args;
 }
 
-std::string CommandProcessor::Execute(const std::vector<std::string>& args)
+std::string CommandProcessor::Execute(const std::vector<std::string>& args, OutputSink& output)
 {
     if (args.empty())
     {
@@ -81,7 +85,9 @@ std::string CommandProcessor::Execute(const std::vector<std::string>& args)
     }
 
     std::string cmd = String::ToUpper(args[0]);
-    CommandContext ctx(s_currentDir);
+    CommandContext ctx(s_currentDir, output);
+    /* Attributes looked up while this command runs are cached until it returns */
+    StatCacheScope statScope(cmd);
 
     if (DriveCommand::Matches(args))
     {
@@ -99,6 +105,14 @@ std::string CommandProcessor::Execute(const std::vector<std::string>& args)
     {
         return CopyCommand::Execute(args, ctx);
     }
+    if (CrcCommand::Matches(cmd))
+    {
+        return CrcCommand::Execute(args, ctx);
+    }
+    if (XcopyCommand::Matches(cmd))
+    {
+        return XcopyCommand::Execute(args, ctx);
+    }
     if (DateCommand::Matches(cmd))
     {
         return DateCommand::Execute(args, ctx);
@@ -143,6 +157,10 @@ std::string CommandProcessor::Execute(const std::vector<std::string>& args)
     {
         return RmdirCommand::Execute(args, ctx);
     }
+    if (DrivesCommand::Matches(cmd))
+    {
+        return DrivesCommand::Execute(args, ctx);
+    }
     if (CdCommand::Matches(cmd))
     {
         return CdCommand::Execute(args, ctx);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "External.h"
+#include "OutputSink.h"
 
 #include <string>
 #include <vector>
@@ -9,7 +10,8 @@ class CommandProcessor
 {
 public:
     static std::vector<std::string> ParseLine(const std::string& line);
-    static std::string Execute(const std::vector<std::string>& args);
+    /** Run a command. Long output is streamed to output; the returned text (messages, control prefixes) follows it. */
+    static std::string Execute(const std::vector<std::string>& args, OutputSink& output);
     static std::string GetCurrentDir();
     /** Current directory formatted for prompt display (e.g. HDD0-E:\ or HDD0-E:\path\). */
     static std::string GetCurrentDirForPrompt();
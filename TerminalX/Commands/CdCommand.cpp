@@ -1,5 +1,5 @@
 #include "CdCommand.h"
-#include "..\DriveMount.h"
+#include "..\PathResolver.h"
 #include <string>
 #include <vector>
 
@@ -14,36 +14,8 @@ std::string CdCommand::Execute(const std::vector<std::string>& args, CommandCont
     {
         return ctx.currentDir + "\n";
     }
-    std::string path = args[1];
-    if (path == "..")
-    {
-        if (ctx.currentDir.length() > 3)
-        {
-            size_t p = ctx.currentDir.find_last_of("\\/", ctx.currentDir.length() - 2);
-            ctx.currentDir = (p != std::string::npos && p >= 2) ? ctx.currentDir.substr(0, p + 1) : "C:\\";
-        }
-    }
-    else if (path.length() >= 2 && path[1] == ':')
-    {
-        std::string driveName = path.substr(0, path.find(':'));
-        DriveMount::Mount(driveName.c_str());
-        ctx.currentDir = path;
-        if (ctx.currentDir[ctx.currentDir.length() - 1] != '\\')
-        {
-            ctx.currentDir += '\\';
-        }
-    }
-    else if (!path.empty())
-    {
-        if (ctx.currentDir[ctx.currentDir.length() - 1] != '\\')
-        {
-            ctx.currentDir += '\\';
-        }
-        ctx.currentDir += path;
-        if (ctx.currentDir[ctx.currentDir.length() - 1] != '\\')
-        {
-            ctx.currentDir += '\\';
-        }
-    }
+    std::string path;
+    PathResolver::Resolve(args[1], ctx.currentDir, path);
+    ctx.currentDir = path + "\\";
     return "";
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "..\OutputSink.h"
 #include <string>
 
 struct CommandContext
 {
     std::string& currentDir;
-    explicit CommandContext(std::string& dir) : currentDir(dir) {}
+    OutputSink& output;  /* streamed output; a command's return value is written after it */
+    CommandContext(std::string& dir, OutputSink& out) : currentDir(dir), output(out) {}
 };
@@ -1,7 +1,8 @@
 #include "CopyCommand.h"
-#include "..\DriveMount.h"
 #include "..\FileSystem.h"
+#include "..\PathResolver.h"
 #include "..\String.h"
+#include "..\Wildcard.h"
 #include <string>
 #include <vector>
 #include <xtl.h>
@@ -11,56 +12,6 @@ static bool IsSwitch(const std::string& a)
     return (a.length() >= 1 && (a[0] == '/' || a[0] == '-'));
 }
 
-static void ResolvePath(const std::string& pathArg, const std::string& currentDir, std::string& outPath)
-{
-    outPath = currentDir;
-    size_t colon = pathArg.find(':');
-    if (colon != std::string::npos)
-    {
-        std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-        std::string pathPart = pathArg.substr(colon + 1);
-        while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-        {
-            pathPart.erase(0, 1);
-        }
-        if (!drivePart.empty())
-        {
-            DriveMount::Mount(drivePart.c_str());
-            outPath = drivePart + "\\";
-            if (!pathPart.empty())
-            {
-                outPath += pathPart;
-                if (outPath[outPath.length() - 1] != '\\')
-                {
-                    outPath += "\\";
-                }
-            }
-        }
-    }
-    else if (!pathArg.empty() && pathArg != "." && pathArg != "..")
-    {
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-        outPath += pathArg;
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-    }
-}
-
-static std::string GetPathWithoutTrailingSlash(const std::string& path)
-{
-    std::string p = path;
-    while (p.length() > 0 && (p[p.length() - 1] == '\\' || p[p.length() - 1] == '/'))
-    {
-        p.erase(p.length() - 1, 1);
-    }
-    return p;
-}
-
 bool CopyCommand::Matches(const std::string& cmd)
 {
     return (cmd == "COPY");
@@ -73,6 +24,7 @@ std::string CopyCommand::Execute(const std::vector<std::string>& args, CommandCo
         return "The syntax of the command is incorrect.\n";
     }
     bool overwrite = true;
+    bool verify = false;
     std::vector<std::string> pathArgs;
     for (size_t i = 1; i < args.size(); i++)
     {
@@ -82,9 +34,10 @@ std::string CopyCommand::Execute(const std::vector<std::string>& args, CommandCo
             if (a == "/?" || a == "-?" || a.find('?') != std::string::npos)
             {
                 return "Copies one or more files to another location.\n\n"
-                       "COPY [/Y | /-Y] source [+ source [+ ...]] [destination]\n\n"
-                       "  source       The file(s) to be copied.\n"
+                       "COPY [/V] [/Y | /-Y] source [+ source [+ ...]] [destination]\n\n"
+                       "  source       The file(s) to be copied (* and ? allowed in the file name).\n"
                        "  destination  The directory and/or filename for the new file(s).\n"
+                       "  /V           Verifies that new files are written correctly.\n"
                        "  /Y           Suppresses prompting to confirm overwriting (default).\n"
                        "  /-Y          Prompts to confirm overwriting (not implemented).\n\n"
                        "To append files: COPY file1+file2+file3 destination\n";
@@ -98,6 +51,10 @@ std::string CopyCommand::Execute(const std::vector<std::string>& args, CommandCo
             {
                 overwrite = false;
             }
+            else if (sw == "/V" || sw == "-V")
+            {
+                verify = true;
+            }
         }
         else
         {
@@ -137,43 +94,54 @@ std::string CopyCommand::Execute(const std::vector<std::string>& args, CommandCo
     {
         return "The syntax of the command is incorrect.\n";
     }
-    std::string destResolved;
-    ResolvePath(destArg, ctx.currentDir, destResolved);
-    std::string destPath = GetPathWithoutTrailingSlash(destResolved);
+    /* Expand wildcard sources in place; the API paths FindFiles returns ("HDD0-E:\x\a.txt") resolve like any drive-qualified path */
+    std::vector<std::string> expanded;
+    for (size_t i = 0; i < sourcePaths.size(); i++)
+    {
+        if (!Wildcard::HasWildcards(sourcePaths[i]))
+        {
+            expanded.push_back(sourcePaths[i]);
+            continue;
+        }
+        std::string srcPath;
+        PathResolver::Resolve(sourcePaths[i], ctx.currentDir, srcPath);
+        std::vector<std::string> matches;
+        std::string err = FileSystem::FindFiles(srcPath, false, matches);
+        if (!err.empty())
+        {
+            return err;
+        }
+        expanded.insert(expanded.end(), matches.begin(), matches.end());
+    }
+    sourcePaths.swap(expanded);
+    std::string destPath;
+    PathResolver::Resolve(destArg, ctx.currentDir, destPath);
     bool destIsDir = FileSystem::IsDirectory(destPath);
     if (sourcePaths.size() == 1 && !destIsDir)
     {
-        std::string srcResolved;
-        ResolvePath(sourcePaths[0], ctx.currentDir, srcResolved);
-        std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
-        return FileSystem::CopyPath(srcPath, destPath, overwrite);
+        std::string srcPath;
+        PathResolver::Resolve(sourcePaths[0], ctx.currentDir, srcPath);
+        return FileSystem::CopyPath(srcPath, destPath, overwrite, &ctx.output, verify);
     }
     if (sourcePaths.size() == 1 && destIsDir)
     {
-        std::string srcResolved;
-        ResolvePath(sourcePaths[0], ctx.currentDir, srcResolved);
-        std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
+        std::string srcPath;
+        PathResolver::Resolve(sourcePaths[0], ctx.currentDir, srcPath);
         size_t slash = srcPath.find_last_of("\\/");
         std::string filename = (slash != std::string::npos) ? srcPath.substr(slash + 1) : srcPath;
         std::string dstPath = destPath + "\\" + filename;
-        return FileSystem::CopyPath(srcPath, dstPath, overwrite);
+        return FileSystem::CopyPath(srcPath, dstPath, overwrite, &ctx.output, verify);
     }
     if (sourcePaths.size() > 1 && destIsDir)
     {
-        std::string destDir = destPath;
-        if (destDir.length() > 0 && destDir[destDir.length() - 1] != '\\')
-        {
-            destDir += "\\";
-        }
         for (size_t i = 0; i < sourcePaths.size(); i++)
         {
-            std::string srcResolved;
-            ResolvePath(sourcePaths[i], ctx.currentDir, srcResolved);
-            std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
+            std::string srcPath;
+            PathResolver::Resolve(sourcePaths[i], ctx.currentDir, srcPath);
             size_t slash = srcPath.find_last_of("\\/");
             std::string filename = (slash != std::string::npos) ? srcPath.substr(slash + 1) : srcPath;
-            std::string dstPath = GetPathWithoutTrailingSlash(destDir + filename);
-            std::string err = FileSystem::CopyPath(srcPath, dstPath, overwrite);
+            std::string dstPath = destPath + "\\" + filename;
+            std::string err = FileSystem::CopyPath(srcPath, dstPath, overwrite, &ctx.output, verify);
             if (!err.empty())
             {
                 return err;
@@ -186,11 +154,11 @@ std::string CopyCommand::Execute(const std::vector<std::string>& args, CommandCo
         std::vector<std::string> srcFull;
         for (size_t i = 0; i < sourcePaths.size(); i++)
         {
-            std::string srcResolved;
-            ResolvePath(sourcePaths[i], ctx.currentDir, srcResolved);
-            srcFull.push_back(GetPathWithoutTrailingSlash(srcResolved));
+            std::string srcPath;
+            PathResolver::Resolve(sourcePaths[i], ctx.currentDir, srcPath);
+            srcFull.push_back(srcPath);
         }
-        return FileSystem::AppendFiles(srcFull, destPath);
+        return FileSystem::AppendFiles(srcFull, destPath, &ctx.output, verify);
     }
     return "";
 }
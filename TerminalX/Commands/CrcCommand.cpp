@@ -0,0 +1,131 @@
+#include "CrcCommand.h"
+#include "..\BlockReader.h"
+#include "..\CRC32.h"
+#include "..\FileSystem.h"
+#include "..\PathResolver.h"
+#include "..\ProgressMeter.h"
+#include "..\String.h"
+#include <string>
+#include <vector>
+#include <xtl.h>
+
+static bool IsSwitch(const std::string& a)
+{
+    return (a.length() >= 1 && (a[0] == '/' || a[0] == '-'));
+}
+
+/** Stream one file through CRC32 and print "CRC  size  path  (MB/s)". */
+static std::string ChecksumOneFile(const std::string& apiPath, OutputSink& output, unsigned __int64& totalBytes)
+{
+    std::string displayPath = FileSystem::FromApiPath(apiPath);
+    BlockReader reader;
+    if (!reader.Open(apiPath))
+    {
+        return "Unable to open " + displayPath + "\n";
+    }
+    DWORD startTick = GetTickCount();
+    ProgressMeter meter(&output, reader.GetSize());
+    uint32_t crc = 0;
+    unsigned __int64 done = 0;
+    const uint8_t* data = NULL;
+    DWORD length = 0;
+    while (reader.Next(data, length))
+    {
+        crc = CRC32::Update(crc, data, length);
+        done += length;
+        meter.Update(done);
+    }
+    bool failed = reader.HadError();
+    meter.Finish(done, !failed);
+    if (failed)
+    {
+        return "Error reading " + displayPath + "\n";
+    }
+    DWORD elapsed = GetTickCount() - startTick;
+    totalBytes += done;
+    std::string line = String::Format("%08X  %15s  %s", (unsigned int)crc, String::FormatBytesWithCommas(done).c_str(), displayPath.c_str());
+    if (elapsed > 0 && done >= 1024 * 1024)
+    {
+        line += String::Format("  (%.1f MB/s)", (double)(__int64)done / (1024.0 * 1024.0) * 1000.0 / (double)elapsed);
+    }
+    output.Write(line + "\n");
+    return "";
+}
+
+bool CrcCommand::Matches(const std::string& cmd)
+{
+    return (cmd == "CRC" || cmd == "HASH");
+}
+
+std::string CrcCommand::Execute(const std::vector<std::string>& args, CommandContext& ctx)
+{
+    bool recursive = false;
+    std::vector<std::string> names;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        std::string a = args[i];
+        if (IsSwitch(a))
+        {
+            if (a.find('?') != std::string::npos)
+            {
+                return "Displays the CRC-32 checksum of one or more files.\n\n"
+                       "CRC [/S] [drive:][path]filename [...]\n"
+                       "HASH [/S] [drive:][path]filename [...]\n\n"
+                       "  filename  File, directory or wildcard (e.g. *.xbe) to checksum.\n"
+                       "  /S        Includes files in all subdirectories.\n";
+            }
+            std::string sw = String::ToUpper(a);
+            if (sw == "/S" || sw == "-S")
+            {
+                recursive = true;
+            }
+            else
+            {
+                return "Invalid switch - " + a + "\n";
+            }
+            continue;
+        }
+        names.push_back(a);
+    }
+    if (names.empty())
+    {
+        return "The syntax of the command is incorrect.\n";
+    }
+
+    DWORD startTick = GetTickCount();
+    unsigned int fileCount = 0;
+    unsigned __int64 totalBytes = 0;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        std::string resolved;
+        PathResolver::Resolve(names[i], ctx.currentDir, resolved);
+        std::vector<std::string> paths;
+        std::string err = FileSystem::FindFiles(resolved, recursive, paths);
+        if (!err.empty())
+        {
+            ctx.output.Write(err);
+            continue;
+        }
+        for (size_t j = 0; j < paths.size(); j++)
+        {
+            err = ChecksumOneFile(paths[j], ctx.output, totalBytes);
+            if (!err.empty())
+            {
+                ctx.output.Write(err);
+                continue;
+            }
+            fileCount++;
+        }
+    }
+    if (fileCount > 1)
+    {
+        DWORD elapsed = GetTickCount() - startTick;
+        if (elapsed == 0)
+        {
+            elapsed = 1;
+        }
+        return String::Format("%u file(s), %s bytes in %.2f s (%.1f MB/s)\n", fileCount, String::FormatBytesWithCommas(totalBytes).c_str(),
+            (double)elapsed / 1000.0, (double)(__int64)totalBytes / (1024.0 * 1024.0) * 1000.0 / (double)elapsed);
+    }
+    return "";
+}
@@ -1,6 +1,6 @@
 #include "DirCommand.h"
-#include "..\DriveMount.h"
 #include "..\FileSystem.h"
+#include "..\PathResolver.h"
 #include "..\String.h"
 #include <string>
 #include <vector>
@@ -51,6 +51,7 @@ std::string DirCommand::Execute(const std::vector<std::string>& args, CommandCon
             }
             else if (sw == "O")
             {
+                dirOpts.sortBy = 'N';
                 std::string val;
                 if (a.length() >= 3 && (a[2] == ':' || a[2] == ' '))
                 {
@@ -86,54 +87,22 @@ std::string DirCommand::Execute(const std::vector<std::string>& args, CommandCon
     {
         return "Displays a list of files and subdirectories in a directory.\n\n"
                "DIR [drive:][path] [/P] [/W] [/A[:]attributes] [/O[:]sortorder] [/?]\n\n"
-               "  [drive:][path]  Specifies drive and/or directory to list.\n\n"
+               "  [drive:][path]  Specifies drive, directory and/or files to list (* and ? allowed in the last part).\n\n"
                "  /P              Pauses after each screenful (inserts --- More ---).\n"
                "  /W              Uses wide list format.\n"
                "  /A[:]attributes D=Dir R=Read-only H=Hidden A=Archive S=System; - prefix excludes.\n"
                "  /O[:]sortorder  N=name D=date S=size E=extension; - prefix reverses.\n"
+               "                  Without /O entries are listed in directory order.\n"
                "  /?              Displays this help.\n";
     }
     std::string path = ctx.currentDir;
     if (!pathArg.empty())
     {
-        size_t colon = pathArg.find(':');
-        if (colon != std::string::npos)
+        if (!PathResolver::Resolve(pathArg, ctx.currentDir, path))
         {
-            std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-            std::string pathPart = pathArg.substr(colon + 1);
-            while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-            {
-                pathPart.erase(0, 1);
-            }
-            if (!drivePart.empty())
-            {
-                if (!DriveMount::Mount(drivePart.c_str()))
-                {
-                    return "The system cannot find the drive specified.\n";
-                }
-                path = drivePart + "\\";
-                if (!pathPart.empty() && pathPart != "." && pathPart != "..")
-                {
-                    path += pathPart;
-                    if (path[path.length() - 1] != '\\')
-                    {
-                        path += "\\";
-                    }
-                }
-            }
-        }
-        else if (pathArg != "." && pathArg != "..")
-        {
-            if (path.length() > 0 && path[path.length() - 1] != '\\')
-            {
-                path += "\\";
-            }
-            path += pathArg;
-            if (path.length() > 0 && path[path.length() - 1] != '\\')
-            {
-                path += "\\";
-            }
+            return "The system cannot find the drive specified.\n";
         }
+        path += "\\";
     }
-    return FileSystem::ListDirectory(path, dirOpts);
+    return FileSystem::ListDirectory(path, dirOpts, ctx.output);
 }
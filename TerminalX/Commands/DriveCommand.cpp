@@ -24,7 +24,7 @@ std::string DriveCommand::Execute(const std::vector<std::string>& args, CommandC
     {
         return "The system cannot find the drive specified.\n";
     }
-    if (!DriveMount::Mount(driveName.c_str()))
+    if (!DriveMount::EnsureMounted(driveName))
     {
         return "The system cannot find the drive specified.\n";
     }
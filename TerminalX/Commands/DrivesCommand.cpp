@@ -0,0 +1,76 @@
+#include "DrivesCommand.h"
+#include "..\DriveMount.h"
+#include "..\String.h"
+#include <string>
+#include <vector>
+
+bool DrivesCommand::Matches(const std::string& cmd)
+{
+    return (cmd == "DRIVES");
+}
+
+std::string DrivesCommand::Execute(const std::vector<std::string>& args, CommandContext& ctx)
+{
+    (void)ctx;
+    bool refresh = false;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        std::string sw = String::ToUpper(args[i]);
+        if (sw.find('?') != std::string::npos)
+        {
+            return "Lists the drives found at startup, with their size and free space.\n\n"
+                   "DRIVES [/R]\n\n"
+                   "  /R  Probes the drives again in the background.\n\n"
+                   "Drives are probed while the prompt is shown; any still being probed are listed as such.\n"
+                   "Sizes are as of the last probe or mount; memory units are read when DRIVES runs.\n";
+        }
+        if (sw == "/R" || sw == "-R")
+        {
+            refresh = true;
+        }
+        else
+        {
+            return "Invalid switch - " + args[i] + "\n";
+        }
+    }
+    if (refresh && !DriveMount::StartProbe())
+    {
+        return "The drives are still being probed.\n";
+    }
+
+    std::vector<DriveInfo> drives;
+    DriveMount::GetDriveInfo(drives);
+    std::string out = String::Format("%-8s  %-8s  %19s  %19s\n", "Drive", "Status", "Total bytes", "Free bytes");
+    unsigned int pending = 0;
+    for (size_t i = 0; i < drives.size(); i++)
+    {
+        const DriveInfo& d = drives[i];
+        if (d.state == DriveStatePending)
+        {
+            out += String::Format("%-8s  %-8s\n", d.name.c_str(), "Probing");
+            pending++;
+        }
+        else if (d.state == DriveStateReady && !d.optical)
+        {
+            out += String::Format("%-8s  %-8s  %19s  %19s\n", d.name.c_str(), "Ready",
+                String::FormatBytesWithCommas(d.totalBytes).c_str(), String::FormatBytesWithCommas(d.freeBytes).c_str());
+        }
+        else if (d.state == DriveStateReady)
+        {
+            out += String::Format("%-8s  %-8s\n", d.name.c_str(), "Disc in");
+        }
+        else if (d.state == DriveStateUnknown)
+        {
+            out += String::Format("%-8s  %-8s\n", d.name.c_str(), "Unknown");
+        }
+        else if (d.optical)
+        {
+            out += String::Format("%-8s  %-8s\n", d.name.c_str(), "No disc");
+        }
+    }
+    if (pending > 0)
+    {
+        out += String::Format("%u drive(s) still being probed.\n", pending);
+    }
+    return out;
+}
@@ -1,6 +1,8 @@
 #include "EditCommand.h"
-#include "..\DriveMount.h"
+#include "..\DirCache.h"
 #include "..\FileSystem.h"
+#include "..\PathResolver.h"
+#include "..\StatCache.h"
 #include "..\String.h"
 #include "..\Drawing.h"
 #include "..\InputManager.h"
@@ -27,50 +29,6 @@ static bool IsSwitch(const std::string& a)
     return (a.length() >= 1 && (a[0] == '/' || a[0] == '-'));
 }
 
-static void ResolvePath(const std::string& pathArg, const std::string& currentDir, std::string& outPath)
-{
-    outPath = currentDir;
-    size_t colon = pathArg.find(':');
-    if (colon != std::string::npos)
-    {
-        std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-        std::string pathPart = pathArg.substr(colon + 1);
-        while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-        {
-            pathPart.erase(0, 1);
-        }
-        if (!drivePart.empty())
-        {
-            DriveMount::Mount(drivePart.c_str());
-            outPath = drivePart + "\\";
-            if (!pathPart.empty() && pathPart != "." && pathPart != "..")
-            {
-                outPath += pathPart;
-            }
-        }
-    }
-    else if (!pathArg.empty() && pathArg != "." && pathArg != "..")
-    {
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-        outPath += pathArg;
-    }
-    while (outPath.length() > 0 && (outPath[outPath.length() - 1] == '\\' || outPath[outPath.length() - 1] == '/'))
-    {
-        outPath.erase(outPath.length() - 1, 1);
-    }
-    if (outPath.empty() && currentDir.length() > 0)
-    {
-        outPath = currentDir;
-        while (outPath.length() > 0 && (outPath[outPath.length() - 1] == '\\' || outPath[outPath.length() - 1] == '/'))
-        {
-            outPath.erase(outPath.length() - 1, 1);
-        }
-    }
-}
-
 /** Load file into lines. Returns empty on success, error message otherwise. */
 static std::string LoadFile(const std::string& path, std::vector<std::string>& lines)
 {
@@ -80,7 +38,7 @@ static std::string LoadFile(const std::string& path, std::vector<std::string>& l
         return "The syntax of the command is incorrect.\n";
     }
     std::string apiPath = FileSystem::ToApiPath(path);
-    DWORD attrs = GetFileAttributesA(apiPath.c_str());
+    DWORD attrs = StatCache::GetAttributes(apiPath);
     if (attrs != 0xFFFFFFFF && (attrs & FILE_ATTRIBUTE_DIRECTORY))
     {
         return "Access is denied.\n";
@@ -94,6 +52,7 @@ static std::string LoadFile(const std::string& path, std::vector<std::string>& l
             if (hCreate != INVALID_HANDLE_VALUE)
             {
                 CloseHandle(hCreate);
+                DirCache::Clear();
             }
             lines.push_back("");
             return "";
@@ -170,6 +129,8 @@ static std::string SaveFile(const std::string& path, const std::vector<std::stri
     {
         return "Access is denied.\n";
     }
+    DirCache::Clear();
+    StatCache::Invalidate(apiPath);
     for (size_t i = 0; i < lines.size(); i++)
     {
         const std::string& line = lines[i];
@@ -226,6 +187,14 @@ static void RunEditorLoop(const std::string& path, std::vector<std::string>& lin
     bool dirty = false;
     bool exitRequested = false;
     std::vector<char> screenBuffer((size_t)(rows * cols), ' ');
+    /* Status bar drawn in the inverse of the current COLOR */
+    std::vector<unsigned char> attrBuffer((size_t)(rows * cols), TERMINAL_ATTR_DEFAULT);
+    unsigned char colorAttr = TerminalBuffer::GetColorAttribute();
+    unsigned char statusAttr = (unsigned char)(((colorAttr & 0x0F) << 4) | ((colorAttr >> 4) & 0x0F));
+    for (int c = 0; c < cols; c++)
+    {
+        attrBuffer[(size_t)(contentRows * cols + c)] = statusAttr;
+    }
 
     ClampCursor(cursorRow, cursorCol, lines);
 
@@ -435,7 +404,7 @@ static void RunEditorLoop(const std::string& path, std::vector<std::string>& lin
             {
                 int srcCol = scrollCol + c;
                 char ch = (srcCol >= 0 && (size_t)srcCol < lineLen) ? linePtr[srcCol] : ' ';
-                if (ch < 32 || ch > 126)
+                if ((unsigned char)ch < 32)
                 {
                     ch = ' ';
                 }
@@ -469,12 +438,12 @@ static void RunEditorLoop(const std::string& path, std::vector<std::string>& lin
         if (cursorY >= 0 && cursorY < contentRows)
         {
             uint32_t color = TerminalBuffer::GetTextColor();
-            Drawing::DrawTerminal(&screenBuffer[0], color, cursorX, cursorY, true);
+            Drawing::DrawTerminal(&screenBuffer[0], &attrBuffer[0], NULL, color, cursorX, cursorY, true);
         }
         else
         {
             uint32_t color = TerminalBuffer::GetTextColor();
-            Drawing::DrawTerminal(&screenBuffer[0], color, -1, -1, false);
+            Drawing::DrawTerminal(&screenBuffer[0], &attrBuffer[0], NULL, color, -1, -1, false);
         }
 
         Sleep(16);
@@ -498,7 +467,7 @@ std::string EditCommand::Execute(const std::vector<std::string>& args, CommandCo
         return "The syntax of the command is incorrect.\n";
     }
     std::string path;
-    ResolvePath(args[1], ctx.currentDir, path);
+    PathResolver::Resolve(args[1], ctx.currentDir, path);
     if (path.empty())
     {
         return "The syntax of the command is incorrect.\n";
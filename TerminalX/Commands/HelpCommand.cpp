@@ -16,8 +16,11 @@ std::string HelpCommand::Execute(const std::vector<std::string>& args, CommandCo
            "CD     Displays the name of or changes the current directory.\n"
            "MD     Creates a directory (MKDIR).\n"
            "RD     Removes a directory (RMDIR).\n"
+           "DRIVES Lists drives with their size and free space.\n"
            "CLS    Clears the screen.\n"
            "COPY   Copies one or more files to another location.\n"
+           "XCOPY  Copies files and directory trees (/S /E).\n"
+           "CRC    Displays the CRC-32 checksum of files (HASH).\n"
            "DATE   Displays or sets the date. Press ENTER to keep the same date.\n"
            "TYPE   Displays the contents of a text file or files.\n"
            "EDIT   Opens a text file for viewing and editing. F2=Save F3=Exit.\n"
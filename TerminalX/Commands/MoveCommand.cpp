@@ -1,6 +1,6 @@
 #include "MoveCommand.h"
-#include "..\DriveMount.h"
 #include "..\FileSystem.h"
+#include "..\PathResolver.h"
 #include "..\String.h"
 #include <string>
 #include <vector>
@@ -10,56 +10,6 @@ static bool IsSwitch(const std::string& a)
     return (a.length() >= 1 && (a[0] == '/' || a[0] == '-'));
 }
 
-static void ResolvePath(const std::string& pathArg, const std::string& currentDir, std::string& outPath)
-{
-    outPath = currentDir;
-    size_t colon = pathArg.find(':');
-    if (colon != std::string::npos)
-    {
-        std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-        std::string pathPart = pathArg.substr(colon + 1);
-        while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-        {
-            pathPart.erase(0, 1);
-        }
-        if (!drivePart.empty())
-        {
-            DriveMount::Mount(drivePart.c_str());
-            outPath = drivePart + "\\";
-            if (!pathPart.empty())
-            {
-                outPath += pathPart;
-                if (outPath[outPath.length() - 1] != '\\')
-                {
-                    outPath += "\\";
-                }
-            }
-        }
-    }
-    else if (!pathArg.empty() && pathArg != "." && pathArg != "..")
-    {
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-        outPath += pathArg;
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-    }
-}
-
-static std::string GetPathWithoutTrailingSlash(const std::string& path)
-{
-    std::string p = path;
-    while (p.length() > 0 && (p[p.length() - 1] == '\\' || p[p.length() - 1] == '/'))
-    {
-        p.erase(p.length() - 1, 1);
-    }
-    return p;
-}
-
 bool MoveCommand::Matches(const std::string& cmd)
 {
     return (cmd == "MOVE");
@@ -90,7 +40,9 @@ std::string MoveCommand::Execute(const std::vector<std::string>& args, CommandCo
                        "  [drive:][path]dirname1   Directory to rename.\n"
                        "  dirname2                 New name of the directory.\n\n"
                        "  /Y    Suppresses prompting to confirm overwriting (default).\n"
-                       "  /-Y   Prompts to confirm overwriting (not implemented).\n";
+                       "  /-Y   Prompts to confirm overwriting (not implemented).\n\n"
+                       "Moves to another drive copy, verify and then delete the source. An interrupted\n"
+                       "move is finished the next time TerminalX starts.\n";
             }
             std::string sw = String::ToUpper(a);
             if (sw == "/Y" || sw == "-Y")
@@ -143,62 +95,52 @@ std::string MoveCommand::Execute(const std::vector<std::string>& args, CommandCo
         return "The syntax of the command is incorrect.\n";
     }
 
-    std::string destResolved;
-    ResolvePath(destArg, ctx.currentDir, destResolved);
-    std::string destPath = GetPathWithoutTrailingSlash(destResolved);
+    std::string destPath;
+    PathResolver::Resolve(destArg, ctx.currentDir, destPath);
     bool destIsDir = FileSystem::IsDirectory(destPath);
 
     /* Rename directory: exactly one source and one dest, and source is a directory */
     if (sourcePaths.size() == 1)
     {
-        std::string srcResolved;
-        ResolvePath(sourcePaths[0], ctx.currentDir, srcResolved);
-        std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
+        std::string srcPath;
+        PathResolver::Resolve(sourcePaths[0], ctx.currentDir, srcPath);
         if (FileSystem::IsDirectory(srcPath))
         {
             /* dirname1 dirname2: rename directory */
-            return FileSystem::MovePath(srcPath, destPath, overwrite);
+            return FileSystem::MovePath(srcPath, destPath, overwrite, &ctx.output);
         }
     }
 
     /* Move file(s) to destination */
     if (sourcePaths.size() == 1 && !destIsDir)
     {
-        std::string srcResolved;
-        ResolvePath(sourcePaths[0], ctx.currentDir, srcResolved);
-        std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
-        return FileSystem::MovePath(srcPath, destPath, overwrite);
+        std::string srcPath;
+        PathResolver::Resolve(sourcePaths[0], ctx.currentDir, srcPath);
+        return FileSystem::MovePath(srcPath, destPath, overwrite, &ctx.output);
     }
     if (sourcePaths.size() == 1 && destIsDir)
     {
-        std::string srcResolved;
-        ResolvePath(sourcePaths[0], ctx.currentDir, srcResolved);
-        std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
+        std::string srcPath;
+        PathResolver::Resolve(sourcePaths[0], ctx.currentDir, srcPath);
         size_t slash = srcPath.find_last_of("\\/");
         std::string filename = (slash != std::string::npos) ? srcPath.substr(slash + 1) : srcPath;
         std::string dstPath = destPath + "\\" + filename;
-        return FileSystem::MovePath(srcPath, dstPath, overwrite);
+        return FileSystem::MovePath(srcPath, dstPath, overwrite, &ctx.output);
     }
     if (sourcePaths.size() > 1 && destIsDir)
     {
-        std::string destDir = destPath;
-        if (destDir.length() > 0 && destDir[destDir.length() - 1] != '\\')
-        {
-            destDir += "\\";
-        }
         for (size_t i = 0; i < sourcePaths.size(); i++)
         {
-            std::string srcResolved;
-            ResolvePath(sourcePaths[i], ctx.currentDir, srcResolved);
-            std::string srcPath = GetPathWithoutTrailingSlash(srcResolved);
+            std::string srcPath;
+            PathResolver::Resolve(sourcePaths[i], ctx.currentDir, srcPath);
             if (FileSystem::IsDirectory(srcPath))
             {
                 return "The directory name is invalid.\n"; /* cannot move multiple including dirs to one dir by name */
             }
             size_t slash = srcPath.find_last_of("\\/");
             std::string filename = (slash != std::string::npos) ? srcPath.substr(slash + 1) : srcPath;
-            std::string dstPath = GetPathWithoutTrailingSlash(destDir + filename);
-            std::string err = FileSystem::MovePath(srcPath, dstPath, overwrite);
+            std::string dstPath = destPath + "\\" + filename;
+            std::string err = FileSystem::MovePath(srcPath, dstPath, overwrite, &ctx.output);
             if (!err.empty())
             {
                 return err;
@@ -1,6 +1,6 @@
 #include "RmdirCommand.h"
-#include "..\DriveMount.h"
 #include "..\FileSystem.h"
+#include "..\PathResolver.h"
 #include "..\String.h"
 #include <string>
 #include <vector>
@@ -54,48 +54,14 @@ std::string RmdirCommand::Execute(const std::vector<std::string>& args, CommandC
     {
         return "The syntax of the command is incorrect.\n";
     }
-    std::string path = ctx.currentDir;
-    size_t colon = pathArg.find(':');
-    if (colon != std::string::npos)
+    if (pathArg == "." || pathArg == "..")
     {
-        std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-        std::string pathPart = pathArg.substr(colon + 1);
-        while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-        {
-            pathPart.erase(0, 1);
-        }
-        if (!drivePart.empty())
-        {
-            if (!DriveMount::Mount(drivePart.c_str()))
-            {
-                return "The system cannot find the drive specified.\n";
-            }
-            path = drivePart + "\\";
-            if (!pathPart.empty())
-            {
-                path += pathPart;
-                if (path[path.length() - 1] != '\\')
-                {
-                    path += "\\";
-                }
-            }
-        }
-    }
-    else if (pathArg != "." && pathArg != "..")
-    {
-        if (path.length() > 0 && path[path.length() - 1] != '\\')
-        {
-            path += "\\";
-        }
-        path += pathArg;
-        if (path.length() > 0 && path[path.length() - 1] != '\\')
-        {
-            path += "\\";
-        }
+        return "The syntax of the command is incorrect.\n";
     }
-    else
+    std::string path;
+    if (!PathResolver::Resolve(pathArg, ctx.currentDir, path))
     {
-        return "The syntax of the command is incorrect.\n";
+        return "The system cannot find the drive specified.\n";
     }
-    return FileSystem::RemoveDir(path, removeTree);
+    return FileSystem::RemoveDir(path, removeTree, &ctx.output);
 }
@@ -1,7 +1,8 @@
 #include "TypeCommand.h"
-#include "..\DriveMount.h"
 #include "..\FileSystem.h"
-#include "..\String.h"
+#include "..\InputManager.h"
+#include "..\PathResolver.h"
+#include "..\StatCache.h"
 #include <string>
 #include <vector>
 #include <xtl.h>
@@ -16,66 +17,23 @@
 #define ERROR_FILE_NOT_FOUND 2
 #endif
 
-static const size_t TYPE_MAX_SIZE = 65536; /* 64 KB */
+/** How often TYPE checks for Ctrl+C / B while streaming a file */
+#define TYPE_CANCEL_POLL_MS 50
 
 static bool IsSwitch(const std::string& a)
 {
     return (a.length() >= 1 && (a[0] == '/' || a[0] == '-'));
 }
 
-static void ResolvePath(const std::string& pathArg, const std::string& currentDir, std::string& outPath)
-{
-    outPath = currentDir;
-    size_t colon = pathArg.find(':');
-    if (colon != std::string::npos)
-    {
-        std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-        std::string pathPart = pathArg.substr(colon + 1);
-        while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-        {
-            pathPart.erase(0, 1);
-        }
-        if (!drivePart.empty())
-        {
-            DriveMount::Mount(drivePart.c_str());
-            outPath = drivePart + "\\";
-            if (!pathPart.empty() && pathPart != "." && pathPart != "..")
-            {
-                outPath += pathPart;
-            }
-        }
-    }
-    else if (!pathArg.empty() && pathArg != "." && pathArg != "..")
-    {
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-        outPath += pathArg;
-    }
-    while (outPath.length() > 0 && (outPath[outPath.length() - 1] == '\\' || outPath[outPath.length() - 1] == '/'))
-    {
-        outPath.erase(outPath.length() - 1, 1);
-    }
-    if (outPath.empty() && currentDir.length() > 0)
-    {
-        outPath = currentDir;
-        while (outPath.length() > 0 && (outPath[outPath.length() - 1] == '\\' || outPath[outPath.length() - 1] == '/'))
-        {
-            outPath.erase(outPath.length() - 1, 1);
-        }
-    }
-}
-
-/** Read file contents and append to out. Returns empty on success, error message otherwise. */
-static std::string TypeOneFile(const std::string& path)
+/** Stream file contents to output in blocks, stopping with cancelled set if Ctrl+C or B is pressed. Returns empty on success, error message otherwise. */
+static std::string TypeOneFile(const std::string& path, OutputSink& output, bool& cancelled)
 {
     if (path.empty())
     {
         return "The syntax of the command is incorrect.\n";
     }
     std::string apiPath = FileSystem::ToApiPath(path);
-    DWORD attrs = GetFileAttributesA(apiPath.c_str());
+    DWORD attrs = StatCache::GetAttributes(apiPath);
     if (attrs == 0xFFFFFFFF)
     {
         DWORD err = GetLastError();
@@ -94,39 +52,34 @@ static std::string TypeOneFile(const std::string& path)
     {
         return "Access is denied.\n";
     }
-    DWORD sizeHigh = 0;
-    DWORD sizeLow = GetFileSize(h, &sizeHigh);
-    if (sizeLow == 0xFFFFFFFF && GetLastError() != NO_ERROR)
-    {
-        CloseHandle(h);
-        return "Access is denied.\n";
-    }
-    if (sizeHigh != 0 || sizeLow > (DWORD)TYPE_MAX_SIZE)
-    {
-        CloseHandle(h);
-        return "File too large.\n";
-    }
-    std::string out;
-    out.reserve(sizeLow);
     char buf[4096];
     DWORD read = 0;
+    DWORD lastPoll = GetTickCount();
     while (ReadFile(h, buf, sizeof(buf), &read, NULL) && read > 0)
     {
         for (DWORD i = 0; i < read; i++)
         {
-            char c = buf[i];
-            if (c == '\0')
+            if (buf[i] == '\0')
             {
-                out += ' ';
+                buf[i] = ' ';
             }
-            else
+        }
+        output.Write(buf, read);
+        /* A multi-GB image would otherwise hold the console until its last block */
+        DWORD now = GetTickCount();
+        if ((DWORD)(now - lastPoll) >= TYPE_CANCEL_POLL_MS)
+        {
+            lastPoll = now;
+            if (InputManager::CancelPressed())
             {
-                out += c;
+                cancelled = true;
+                CloseHandle(h);
+                return "^C\n";
             }
         }
     }
     CloseHandle(h);
-    return out;
+    return "";
 }
 
 bool TypeCommand::Matches(const std::string& cmd)
@@ -140,7 +93,6 @@ std::string TypeCommand::Execute(const std::vector<std::string>& args, CommandCo
     {
         return "The syntax of the command is incorrect.\n";
     }
-    std::string result;
     bool hadFileArg = false;
     for (size_t i = 1; i < args.size(); i++)
     {
@@ -151,18 +103,24 @@ std::string TypeCommand::Execute(const std::vector<std::string>& args, CommandCo
             {
                 return "Displays the contents of a text file or files.\n\n"
                        "TYPE [drive:][path]filename\n\n"
-                       "  [drive:][path]filename  Specifies the file or files to display.\n";
+                       "  [drive:][path]filename  Specifies the file or files to display.\n\n"
+                       "Press Ctrl+C (or B on a controller) to stop.\n";
             }
             continue;
         }
         hadFileArg = true;
         std::string path;
-        ResolvePath(a, ctx.currentDir, path);
-        result += TypeOneFile(path);
+        PathResolver::Resolve(a, ctx.currentDir, path);
+        bool cancelled = false;
+        ctx.output.Write(TypeOneFile(path, ctx.output, cancelled));
+        if (cancelled)
+        {
+            break;
+        }
     }
     if (!hadFileArg)
     {
         return "The syntax of the command is incorrect.\n";
     }
-    return result;
+    return "";
 }
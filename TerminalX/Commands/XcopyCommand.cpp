@@ -0,0 +1,101 @@
+#include "XcopyCommand.h"
+#include "..\FileSystem.h"
+#include "..\PathResolver.h"
+#include "..\String.h"
+#include <string>
+#include <vector>
+
+static bool IsSwitch(const std::string& a)
+{
+    return (a.length() >= 1 && (a[0] == '/' || a[0] == '-'));
+}
+
+bool XcopyCommand::Matches(const std::string& cmd)
+{
+    return (cmd == "XCOPY");
+}
+
+std::string XcopyCommand::Execute(const std::vector<std::string>& args, CommandContext& ctx)
+{
+    TreeCopyOptions options;
+    std::vector<std::string> pathArgs;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        std::string a = args[i];
+        if (IsSwitch(a))
+        {
+            if (a.find('?') != std::string::npos)
+            {
+                return "Copies files and directory trees.\n\n"
+                       "XCOPY source [destination] [/S [/E]] [/Y | /-Y] [/Q]\n\n"
+                       "  source       Directory (or single file) to copy.\n"
+                       "  destination  Where to copy to; created if missing. Default: current directory.\n"
+                       "  /S           Copies directories and subdirectories except empty ones.\n"
+                       "  /E           Copies directories and subdirectories, including empty ones.\n"
+                       "  /Y           Overwrites existing files (default).\n"
+                       "  /-Y          Stops at the first file that already exists.\n"
+                       "  /Q           Does not display file names while copying.\n";
+            }
+            std::string sw = String::ToUpper(a);
+            if (sw == "/S" || sw == "-S")
+            {
+                options.subdirs = true;
+            }
+            else if (sw == "/E" || sw == "-E")
+            {
+                options.emptyDirs = true;
+            }
+            else if (sw == "/Y" || sw == "-Y")
+            {
+                options.overwrite = true;
+            }
+            else if (sw == "/-Y" || sw == "--Y")
+            {
+                options.overwrite = false;
+            }
+            else if (sw == "/Q" || sw == "-Q")
+            {
+                options.quiet = true;
+            }
+            else
+            {
+                return "Invalid switch - " + a + "\n";
+            }
+        }
+        else
+        {
+            pathArgs.push_back(a);
+        }
+    }
+    if (pathArgs.empty() || pathArgs.size() > 2)
+    {
+        return "Invalid number of parameters\n";
+    }
+
+    std::string srcPath;
+    PathResolver::Resolve(pathArgs[0], ctx.currentDir, srcPath);
+    std::string destPath;
+    PathResolver::Resolve(pathArgs.size() == 2 ? pathArgs[1] : std::string(), ctx.currentDir, destPath);
+
+    if (!FileSystem::Exists(srcPath))
+    {
+        return "File not found - " + pathArgs[0] + "\n";
+    }
+    if (!FileSystem::IsDirectory(srcPath))
+    {
+        /* A single file behaves like COPY, into destination if it is a directory */
+        std::string dstPath = destPath;
+        if (FileSystem::IsDirectory(destPath))
+        {
+            size_t slash = srcPath.find_last_of("\\/");
+            dstPath = destPath + "\\" + ((slash != std::string::npos) ? srcPath.substr(slash + 1) : srcPath);
+        }
+        std::string err = FileSystem::CopyPath(srcPath, dstPath, options.overwrite, &ctx.output);
+        if (!err.empty())
+        {
+            return err;
+        }
+        return "1 File(s) copied\n";
+    }
+    return FileSystem::CopyTree(srcPath, destPath, options, ctx.output);
+}
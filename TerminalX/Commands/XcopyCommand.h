@@ -0,0 +1,12 @@
+#pragma once
+
+#include "CommandContext.h"
+#include <string>
+#include <vector>
+
+class XcopyCommand
+{
+public:
+    static bool Matches(const std::string& cmd);
+    static std::string Execute(const std::vector<std::string>& args, CommandContext& ctx);
+};
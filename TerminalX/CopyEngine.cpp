@@ -0,0 +1,470 @@
+#include "CopyEngine.h"
+#include "BlockReader.h"
+#include "CRC32.h"
+#include "ProgressMeter.h"
+#include "StatCache.h"
+#include "String.h"
+
+#define COPY_BLOCK_SIZE (1024 * 1024)
+#define COPY_BLOCK_COUNT 3
+#define COPY_SECTOR_ALIGN 4096
+#define COPY_VERIFY_CHUNK (64 * 1024)
+#define COPY_VERIFY_MAX_REPORTED 16
+
+namespace
+{
+    int s_batchDepth = 0;   /* while non-zero the pipeline buffers are kept between copies */
+
+    void BeginChecksums(CopyChecksums* checksums, unsigned __int64 offset, unsigned __int64 size)
+    {
+        if (checksums != NULL)
+        {
+            checksums->offset = offset;
+            checksums->size = size;
+            checksums->crcs.clear();
+            checksums->crcs.reserve((size_t)((size + COPY_VERIFY_CHUNK - 1) / COPY_VERIFY_CHUNK));
+        }
+    }
+
+    /** Blocks are whole multiples of COPY_VERIFY_CHUNK apart from the last, so chunks never straddle two blocks. */
+    void AddChecksums(CopyChecksums* checksums, const uint8_t* data, DWORD length)
+    {
+        if (checksums == NULL)
+        {
+            return;
+        }
+        for (DWORD offset = 0; offset < length; offset += COPY_VERIFY_CHUNK)
+        {
+            DWORD piece = (length - offset < COPY_VERIFY_CHUNK) ? length - offset : COPY_VERIFY_CHUNK;
+            checksums->crcs.push_back(CRC32::Calculate(data + offset, piece));
+        }
+    }
+
+    std::string FormatOffset(unsigned __int64 offset)
+    {
+        DWORD high = (DWORD)(offset >> 32);
+        if (high != 0)
+        {
+            return String::Format("0x%X%08X", (unsigned int)high, (unsigned int)(DWORD)offset);
+        }
+        return String::Format("0x%X", (unsigned int)(DWORD)offset);
+    }
+}
+
+namespace
+{
+    /** One pipeline buffer; a block is read into it, written out, then the buffer is refilled COPY_BLOCK_COUNT blocks ahead. */
+    struct CopySlot
+    {
+        uint8_t* buffer;
+        OVERLAPPED readOverlapped;
+        OVERLAPPED writeOverlapped;
+        DWORD length;       /* file bytes held in buffer */
+        DWORD writeLength;  /* bytes handed to WriteFile (rounded up to a sector for unbuffered writes) */
+        bool reading;
+        bool writing;
+    };
+
+    void SetOffset(OVERLAPPED& overlapped, unsigned __int64 offset)
+    {
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    }
+
+    bool SetFileSize(HANDLE handle, unsigned __int64 size)
+    {
+        LONG high = (LONG)(size >> 32);
+        DWORD low = SetFilePointer(handle, (LONG)(DWORD)size, &high, FILE_BEGIN);
+        if (low == (DWORD)-1 && GetLastError() != NO_ERROR)
+        {
+            return false;
+        }
+        return SetEndOfFile(handle) != FALSE;
+    }
+
+    bool StartRead(HANDLE handle, CopySlot& slot, unsigned __int64 offset)
+    {
+        DWORD done = 0;
+        SetOffset(slot.readOverlapped, offset);
+        if (!ReadFile(handle, slot.buffer, COPY_BLOCK_SIZE, &done, &slot.readOverlapped) && GetLastError() != ERROR_IO_PENDING)
+        {
+            return false;
+        }
+        slot.reading = true;
+        return true;
+    }
+
+    bool StartWrite(HANDLE handle, CopySlot& slot, unsigned __int64 offset, DWORD length)
+    {
+        DWORD done = 0;
+        SetOffset(slot.writeOverlapped, offset);
+        slot.writeLength = length;
+        if (!WriteFile(handle, slot.buffer, length, &done, &slot.writeOverlapped) && GetLastError() != ERROR_IO_PENDING)
+        {
+            return false;
+        }
+        slot.writing = true;
+        return true;
+    }
+
+    /** Wait for an outstanding transfer; returns false if it failed. */
+    bool Complete(HANDLE handle, OVERLAPPED& overlapped, bool& pending, DWORD& transferred)
+    {
+        pending = false;
+        transferred = 0;
+        return GetOverlappedResult(handle, &overlapped, &transferred, TRUE) != FALSE;
+    }
+
+    uint8_t* s_buffers = NULL;
+    HANDLE s_events[COPY_BLOCK_COUNT * 2];
+
+    void ReleaseBuffers()
+    {
+        for (int i = 0; i < COPY_BLOCK_COUNT * 2; i++)
+        {
+            if (s_events[i] != NULL)
+            {
+                CloseHandle(s_events[i]);
+                s_events[i] = NULL;
+            }
+        }
+        if (s_buffers != NULL)
+        {
+            VirtualFree(s_buffers, 0, MEM_RELEASE);
+            s_buffers = NULL;
+        }
+    }
+
+    bool AcquireBuffers()
+    {
+        if (s_buffers != NULL)
+        {
+            return true;
+        }
+        s_buffers = (uint8_t*)VirtualAlloc(NULL, COPY_BLOCK_SIZE * COPY_BLOCK_COUNT, MEM_COMMIT, PAGE_READWRITE);
+        bool ok = (s_buffers != NULL);
+        for (int i = 0; i < COPY_BLOCK_COUNT * 2; i++)
+        {
+            s_events[i] = CreateEvent(NULL, TRUE, FALSE, NULL);
+            ok = ok && (s_events[i] != NULL);
+        }
+        if (!ok)
+        {
+            ReleaseBuffers();
+        }
+        return ok;
+    }
+
+    std::string ErrorMessage(DWORD error, CopyMode mode)
+    {
+        if (error == ERROR_FILE_EXISTS || error == ERROR_ALREADY_EXISTS)
+        {
+            return "File exists.\n";
+        }
+        if (error == ERROR_PATH_NOT_FOUND)
+        {
+            return "The system cannot find the path specified.\n";
+        }
+        if (error == ERROR_DISK_FULL || error == ERROR_HANDLE_DISK_FULL)
+        {
+            return "There is not enough space on the disk.\n";
+        }
+        return (mode == COPY_APPEND) ? "Unable to write destination.\n" : "Unable to copy file.\n";
+    }
+}
+
+std::string CopyEngine::Copy(const std::string& srcApi, const std::string& dstApi, CopyMode mode, OutputSink* progress, CopyChecksums* checksums, DWORD srcAttributes)
+{
+    bool append = (mode == COPY_APPEND);
+    DWORD srcAttr = srcAttributes;
+    if (srcAttr == 0xFFFFFFFF && !append)
+    {
+        srcAttr = StatCache::GetAttributes(srcApi);
+    }
+    HANDLE hSrc = CreateFileA(srcApi.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL);
+    if (hSrc == INVALID_HANDLE_VALUE)
+    {
+        return "The system cannot find the file specified.\n";
+    }
+    DWORD sizeHigh = 0;
+    DWORD sizeLow = GetFileSize(hSrc, &sizeHigh);
+    if (sizeLow == 0xFFFFFFFF && GetLastError() != NO_ERROR)
+    {
+        CloseHandle(hSrc);
+        return "Unable to copy file.\n";
+    }
+    unsigned __int64 size = ((unsigned __int64)sizeHigh << 32) | sizeLow;
+
+    /* Appends land at arbitrary offsets, so only whole-file copies bypass the cache */
+    DWORD disposition = append ? OPEN_EXISTING : ((mode == COPY_CREATE_NEW) ? CREATE_NEW : CREATE_ALWAYS);
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | (append ? 0 : FILE_FLAG_NO_BUFFERING);
+    HANDLE hDst = CreateFileA(dstApi.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, disposition, flags, NULL);
+    if (hDst == INVALID_HANDLE_VALUE)
+    {
+        DWORD error = GetLastError();
+        CloseHandle(hSrc);
+        return append ? "Unable to open destination for append.\n" : ErrorMessage(error, mode);
+    }
+
+    unsigned __int64 base = 0;
+    if (append)
+    {
+        DWORD baseHigh = 0;
+        DWORD baseLow = GetFileSize(hDst, &baseHigh);
+        if (baseLow == 0xFFFFFFFF && GetLastError() != NO_ERROR)
+        {
+            CloseHandle(hSrc);
+            CloseHandle(hDst);
+            return "Unable to seek destination.\n";
+        }
+        base = ((unsigned __int64)baseHigh << 32) | baseLow;
+    }
+
+    std::string result;
+    CopySlot slots[COPY_BLOCK_COUNT];
+    memset(slots, 0, sizeof(slots));
+
+    /* Reserve the whole destination up front so FATX allocates its clusters once; a single block extends the file in one write anyway */
+    if (size > COPY_BLOCK_SIZE && !SetFileSize(hDst, base + size))
+    {
+        result = ErrorMessage(GetLastError(), mode);
+    }
+    if (result.empty() && size > 0)
+    {
+        if (!AcquireBuffers())
+        {
+            result = "Insufficient memory to copy file.\n";
+        }
+        else
+        {
+            for (int i = 0; i < COPY_BLOCK_COUNT; i++)
+            {
+                slots[i].buffer = s_buffers + i * COPY_BLOCK_SIZE;
+                slots[i].readOverlapped.hEvent = s_events[i * 2];
+                slots[i].writeOverlapped.hEvent = s_events[i * 2 + 1];
+            }
+        }
+    }
+
+    BeginChecksums(checksums, base, size);
+    ProgressMeter meter(progress, size);
+    unsigned __int64 done = 0;
+    unsigned __int64 blockCount = (size + COPY_BLOCK_SIZE - 1) / COPY_BLOCK_SIZE;
+    unsigned __int64 nextRead = 0;
+    DWORD transferred = 0;
+    while (result.empty() && nextRead < blockCount && nextRead < COPY_BLOCK_COUNT)
+    {
+        if (!StartRead(hSrc, slots[nextRead], nextRead * COPY_BLOCK_SIZE))
+        {
+            result = "Unable to copy file.\n";
+        }
+        nextRead++;
+    }
+
+    /* Block n is written as soon as it arrives; block n-1's write is then retired and its buffer refilled, so one write and up to two reads are always in flight */
+    for (unsigned __int64 block = 0; result.empty() && block < blockCount; block++)
+    {
+        CopySlot& slot = slots[block % COPY_BLOCK_COUNT];
+        unsigned __int64 remaining = size - block * COPY_BLOCK_SIZE;
+        slot.length = (remaining < COPY_BLOCK_SIZE) ? (DWORD)remaining : COPY_BLOCK_SIZE;
+        if (!Complete(hSrc, slot.readOverlapped, slot.reading, transferred) || transferred < slot.length)
+        {
+            result = "Unable to copy file.\n";
+            break;
+        }
+        DWORD writeLength = append ? slot.length : ((slot.length + COPY_SECTOR_ALIGN - 1) & ~(DWORD)(COPY_SECTOR_ALIGN - 1));
+        if (!StartWrite(hDst, slot, base + block * COPY_BLOCK_SIZE, writeLength))
+        {
+            result = ErrorMessage(GetLastError(), mode);
+            break;
+        }
+        AddChecksums(checksums, slot.buffer, slot.length);
+        if (block > 0)
+        {
+            CopySlot& previous = slots[(block - 1) % COPY_BLOCK_COUNT];
+            if (!Complete(hDst, previous.writeOverlapped, previous.writing, transferred) || transferred != previous.writeLength)
+            {
+                result = ErrorMessage(GetLastError(), mode);
+                break;
+            }
+            done += previous.length;
+            meter.Update(done);
+            if (nextRead < blockCount)
+            {
+                if (!StartRead(hSrc, previous, nextRead * COPY_BLOCK_SIZE))
+                {
+                    result = "Unable to copy file.\n";
+                    break;
+                }
+                nextRead++;
+            }
+        }
+    }
+    if (result.empty() && blockCount > 0)
+    {
+        CopySlot& last = slots[(blockCount - 1) % COPY_BLOCK_COUNT];
+        if (!Complete(hDst, last.writeOverlapped, last.writing, transferred) || transferred != last.writeLength)
+        {
+            result = ErrorMessage(GetLastError(), mode);
+        }
+        else
+        {
+            done += last.length;
+        }
+    }
+
+    /* Never free a buffer the kernel may still be filling */
+    for (int i = 0; i < COPY_BLOCK_COUNT; i++)
+    {
+        if (slots[i].reading)
+        {
+            Complete(hSrc, slots[i].readOverlapped, slots[i].reading, transferred);
+        }
+        if (slots[i].writing)
+        {
+            Complete(hDst, slots[i].writeOverlapped, slots[i].writing, transferred);
+        }
+    }
+    if (s_batchDepth == 0)
+    {
+        ReleaseBuffers();
+    }
+
+    if (result.empty() && !append)
+    {
+        /* Drop the sector padding of the last write and keep the source timestamp, as CopyFile does */
+        if (!SetFileSize(hDst, size))
+        {
+            result = "Unable to copy file.\n";
+        }
+        FILETIME lastWrite;
+        if (GetFileTime(hSrc, NULL, NULL, &lastWrite))
+        {
+            SetFileTime(hDst, NULL, NULL, &lastWrite);
+        }
+    }
+    else if (!result.empty() && append)
+    {
+        /* A failed append leaves the destination as it was */
+        SetFileSize(hDst, base);
+    }
+    CloseHandle(hSrc);
+    CloseHandle(hDst);
+
+    if (!append)
+    {
+        if (!result.empty())
+        {
+            DeleteFileA(dstApi.c_str());
+        }
+        else if (srcAttr != 0xFFFFFFFF)
+        {
+            SetFileAttributesA(dstApi.c_str(), srcAttr);
+        }
+    }
+    StatCache::Invalidate(dstApi);
+    meter.Finish(done, result.empty());
+    return result;
+}
+
+void CopyEngine::BeginBatch()
+{
+    s_batchDepth++;
+}
+
+void CopyEngine::EndBatch()
+{
+    if (s_batchDepth > 0)
+    {
+        s_batchDepth--;
+        if (s_batchDepth == 0)
+        {
+            ReleaseBuffers();
+        }
+    }
+}
+
+std::string CopyEngine::Verify(const std::string& dstApi, const CopyChecksums& checksums, OutputSink* output)
+{
+    BlockReader reader;
+    if (!reader.Open(dstApi))
+    {
+        return "Unable to open destination to verify.\n";
+    }
+    unsigned __int64 end = checksums.offset + checksums.size;
+    if (reader.GetSize() < end)
+    {
+        return "Verify failed: the destination is shorter than the source.\n";
+    }
+
+    ProgressMeter meter(output, end);
+    unsigned __int64 position = 0;
+    size_t chunk = 0;
+    DWORD chunkFill = 0;
+    uint32_t crc = 0;
+    unsigned int badRanges = 0;
+    bool inBadRange = false;
+    unsigned __int64 badStart = 0;
+    const uint8_t* data = NULL;
+    DWORD length = 0;
+    while (position < end && reader.Next(data, length))
+    {
+        unsigned __int64 blockEnd = position + length;
+        unsigned __int64 from = (position > checksums.offset) ? position : checksums.offset;
+        unsigned __int64 to = (blockEnd < end) ? blockEnd : end;
+        while (from < to)
+        {
+            unsigned __int64 left = to - from;
+            DWORD take = (left < (unsigned __int64)(COPY_VERIFY_CHUNK - chunkFill)) ? (DWORD)left : COPY_VERIFY_CHUNK - chunkFill;
+            crc = CRC32::Update(crc, data + (DWORD)(from - position), take);
+            chunkFill += take;
+            from += take;
+            if (chunkFill < COPY_VERIFY_CHUNK && from < end)
+            {
+                continue;
+            }
+            /* Adjacent bad chunks are reported as one byte range */
+            unsigned __int64 chunkStart = checksums.offset + (unsigned __int64)chunk * COPY_VERIFY_CHUNK;
+            bool bad = (chunk >= checksums.crcs.size() || crc != checksums.crcs[chunk]);
+            if (bad && !inBadRange)
+            {
+                inBadRange = true;
+                badStart = chunkStart;
+            }
+            else if (!bad && inBadRange)
+            {
+                inBadRange = false;
+                if (output != NULL && badRanges < COPY_VERIFY_MAX_REPORTED)
+                {
+                    output->Write("Mismatch at bytes " + FormatOffset(badStart) + "-" + FormatOffset(chunkStart - 1) + "\n");
+                }
+                badRanges++;
+            }
+            chunk++;
+            chunkFill = 0;
+            crc = 0;
+        }
+        position = blockEnd;
+        meter.Update(position);
+    }
+    bool readFailed = (position < end);
+    meter.Finish(position, !readFailed);
+    if (inBadRange)
+    {
+        if (output != NULL && badRanges < COPY_VERIFY_MAX_REPORTED)
+        {
+            output->Write("Mismatch at bytes " + FormatOffset(badStart) + "-" + FormatOffset(end - 1) + "\n");
+        }
+        badRanges++;
+    }
+    if (readFailed)
+    {
+        return "Verify failed: unable to read the destination.\n";
+    }
+    if (badRanges > 0)
+    {
+        return String::Format("Verify failed: %u range(s) of the destination differ from the source.\n", badRanges);
+    }
+    return "";
+}
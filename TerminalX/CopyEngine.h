@@ -0,0 +1,37 @@
+#pragma once
+
+#include "External.h"
+#include "OutputSink.h"
+
+#include <string>
+#include <vector>
+
+/** How CopyEngine::Copy opens the destination. */
+enum CopyMode
+{
+    COPY_CREATE_NEW,    /* fail with "File exists." if the destination exists */
+    COPY_OVERWRITE,     /* replace the destination */
+    COPY_APPEND         /* add to the end of an existing destination */
+};
+
+/** Per-chunk CRCs of the data a copy wrote, for CopyEngine::Verify. */
+struct CopyChecksums
+{
+    unsigned __int64 offset;        /* where the copied data starts in the destination (non-zero for appends) */
+    unsigned __int64 size;
+    std::vector<uint32_t> crcs;     /* one per COPY_VERIFY_CHUNK bytes, the last one may be short */
+    CopyChecksums() : offset(0), size(0) {}
+};
+
+/** Copies one file through a triple-buffered pipeline of 1 MB aligned blocks, overlapping the read of the next block with the write of the current one. */
+class CopyEngine
+{
+public:
+    /** Copy srcApi to dstApi (Win32 paths). Copies that run longer than half a second write a "\r" progress line (percent, MB/s, ETA) to progress if it is not NULL. With checksums, each chunk's CRC is taken from the source data while its write is in flight. srcAttributes, when the caller already listed them, are given to the copy instead of being looked up. Returns empty or error message */
+    static std::string Copy(const std::string& srcApi, const std::string& dstApi, CopyMode mode, OutputSink* progress, CopyChecksums* checksums = NULL, DWORD srcAttributes = 0xFFFFFFFF);
+    /** Re-read the copied range of dstApi from disk and compare it with the checksums Copy collected. Mismatching byte ranges are written to output. Returns empty or error message */
+    static std::string Verify(const std::string& dstApi, const CopyChecksums& checksums, OutputSink* output);
+    /** Keep the pipeline buffers allocated across Copy calls until the matching EndBatch (for copying many small files). */
+    static void BeginBatch();
+    static void EndBatch();
+};
@@ -0,0 +1,156 @@
+#include "DirCache.h"
+#include "DirEnumerator.h"
+#include "FileSystem.h"
+#include "String.h"
+
+#include <algorithm>
+
+#define DIR_CACHE_MAX_DIRS 8
+/* Listings older than this are re-read, so changes made outside the shell (disc swap, FTP) show up */
+#define DIR_CACHE_MAX_AGE_MS 5000
+
+namespace
+{
+    struct CachedName
+    {
+        std::string upper;
+        std::string name;
+        bool isDir;
+    };
+
+    struct CachedDir
+    {
+        std::string key;                /* upper-cased path without trailing backslash */
+        std::vector<CachedName> names;  /* sorted by upper */
+        DWORD loadedTick;
+        DWORD lastUsed;
+    };
+
+    std::vector<CachedDir> s_dirs;
+    DWORD s_useCounter = 0;
+}
+
+static bool UpperLess(const CachedName& a, const CachedName& b)
+{
+    return a.upper < b.upper;
+}
+
+static bool UpperLessThanPrefix(const CachedName& a, const std::string& prefix)
+{
+    return a.upper < prefix;
+}
+
+static std::string MakeKey(const std::string& dirPath)
+{
+    std::string key = String::ToUpper(dirPath);
+    for (size_t i = 0; i < key.length(); i++)
+    {
+        if (key[i] == '/')
+        {
+            key[i] = '\\';
+        }
+    }
+    while (key.length() > 0 && key[key.length() - 1] == '\\')
+    {
+        key.erase(key.length() - 1, 1);
+    }
+    return key;
+}
+
+/** Read dirPath from disk into dir; returns false if it cannot be listed. */
+static bool LoadDir(const std::string& dirPath, CachedDir& dir)
+{
+    DirEnumerator enumerator;
+    if (!enumerator.Open(FileSystem::ToApiPath(dirPath)))
+    {
+        return false;
+    }
+    dir.names.clear();
+    DirEnumEntry entry;
+    while (enumerator.Next(entry))
+    {
+        CachedName cached;
+        cached.name.assign(entry.name, entry.nameLength);
+        cached.upper = String::ToUpper(cached.name);
+        cached.isDir = entry.isDir;
+        dir.names.push_back(cached);
+    }
+    std::sort(dir.names.begin(), dir.names.end(), UpperLess);
+    dir.loadedTick = GetTickCount();
+    return true;
+}
+
+/** Cached listing for dirPath, loading it (and evicting the least recently used listing) on a miss. */
+static const CachedDir* FindDir(const std::string& dirPath)
+{
+    std::string key = MakeKey(dirPath);
+    DWORD now = GetTickCount();
+    for (size_t i = 0; i < s_dirs.size(); i++)
+    {
+        if (s_dirs[i].key != key)
+        {
+            continue;
+        }
+        if ((DWORD)(now - s_dirs[i].loadedTick) > DIR_CACHE_MAX_AGE_MS && !LoadDir(dirPath, s_dirs[i]))
+        {
+            s_dirs.erase(s_dirs.begin() + i);
+            return NULL;
+        }
+        s_dirs[i].lastUsed = ++s_useCounter;
+        return &s_dirs[i];
+    }
+
+    CachedDir loaded;
+    if (!LoadDir(dirPath, loaded))
+    {
+        return NULL;
+    }
+    loaded.key = key;
+    loaded.lastUsed = ++s_useCounter;
+    if (s_dirs.size() < DIR_CACHE_MAX_DIRS)
+    {
+        s_dirs.push_back(loaded);
+        return &s_dirs.back();
+    }
+    size_t oldest = 0;
+    for (size_t i = 1; i < s_dirs.size(); i++)
+    {
+        if (s_dirs[i].lastUsed < s_dirs[oldest].lastUsed)
+        {
+            oldest = i;
+        }
+    }
+    s_dirs[oldest].key.swap(loaded.key);
+    s_dirs[oldest].names.swap(loaded.names);
+    s_dirs[oldest].loadedTick = loaded.loadedTick;
+    s_dirs[oldest].lastUsed = loaded.lastUsed;
+    return &s_dirs[oldest];
+}
+
+bool DirCache::GetCompletions(const std::string& dirPath, const std::string& prefix, std::vector<std::string>& outNames, std::vector<bool>& outIsDir)
+{
+    outNames.clear();
+    outIsDir.clear();
+    const CachedDir* dir = FindDir(dirPath);
+    if (dir == NULL)
+    {
+        return false;
+    }
+    std::string upperPrefix = String::ToUpper(prefix);
+    std::vector<CachedName>::const_iterator it = std::lower_bound(dir->names.begin(), dir->names.end(), upperPrefix, UpperLessThanPrefix);
+    for (; it != dir->names.end(); ++it)
+    {
+        if (it->upper.compare(0, upperPrefix.length(), upperPrefix) != 0)
+        {
+            break;
+        }
+        outNames.push_back(it->name);
+        outIsDir.push_back(it->isDir);
+    }
+    return true;
+}
+
+void DirCache::Clear()
+{
+    s_dirs.clear();
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "External.h"
+
+#include <string>
+#include <vector>
+
+/** Small LRU cache of directory listings (names sorted case-insensitively) used by Tab completion. */
+class DirCache
+{
+public:
+    /** Fill outNames/outIsDir with entries of dirPath (internal path) starting with prefix, in sorted order. Returns false if the directory cannot be listed. */
+    static bool GetCompletions(const std::string& dirPath, const std::string& prefix, std::vector<std::string>& outNames, std::vector<bool>& outIsDir);
+    /** Drop every cached listing; called by anything that changes directory contents or mounts. */
+    static void Clear();
+};
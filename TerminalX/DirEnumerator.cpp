@@ -0,0 +1,143 @@
+#include "DirEnumerator.h"
+
+#define DIR_ENUM_BUFFER_SIZE (64 * 1024)
+
+#ifndef FILE_LIST_DIRECTORY
+#define FILE_LIST_DIRECTORY 0x0001
+#endif
+#ifndef SYNCHRONIZE
+#define SYNCHRONIZE 0x00100000L
+#endif
+
+static bool IsDotEntry(const char* name, size_t length)
+{
+    return (length == 1 && name[0] == '.') || (length == 2 && name[0] == '.' && name[1] == '.');
+}
+
+DirEnumerator::DirEnumerator()
+    : mHandle(NULL), mBuffer(NULL), mBufferUsed(0), mOffset(0), mFirstBatch(true), mDone(true), mNotFound(false)
+{
+    mName[0] = 0;
+}
+
+DirEnumerator::~DirEnumerator()
+{
+    Close();
+    free(mBuffer);
+}
+
+bool DirEnumerator::WasNotFound() const
+{
+    return mNotFound;
+}
+
+bool DirEnumerator::Open(const std::string& apiPath)
+{
+    Close();
+    mNotFound = false;
+
+    /* "HDD0-E:\Games\" -> "\??\HDD0-E:\Games"; a volume root keeps its backslash */
+    mPath = "\\??\\" + apiPath;
+    while (mPath.length() > 1 && mPath[mPath.length() - 1] == '\\' && mPath[mPath.length() - 2] != ':')
+    {
+        mPath.erase(mPath.length() - 1, 1);
+    }
+    if (mPath[mPath.length() - 1] == ':')
+    {
+        mPath += "\\";
+    }
+
+    if (mBuffer == NULL)
+    {
+        mBuffer = (uint8_t*)malloc(DIR_ENUM_BUFFER_SIZE);
+        if (mBuffer == NULL)
+        {
+            return false;
+        }
+    }
+
+    STRING objectName;
+    objectName.Length = (WORD)mPath.length();
+    objectName.MaximumLength = (WORD)(mPath.length() + 1);
+    objectName.Buffer = (PSTR)mPath.c_str();
+    OBJECT_ATTRIBUTES attributes;
+    attributes.RootDirectory = NULL;
+    attributes.ObjectName = &objectName;
+    attributes.Attributes = OBJ_CASE_INSENSITIVE;
+    IO_STATUS_BLOCK ioStatus;
+    NTSTATUS status = NtOpenFile(&mHandle, FILE_LIST_DIRECTORY | SYNCHRONIZE, &attributes, &ioStatus,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT);
+    if (status != STATUS_SUCCESS)
+    {
+        mHandle = NULL;
+        mNotFound = (status == STATUS_OBJECT_NAME_NOT_FOUND || status == STATUS_OBJECT_PATH_NOT_FOUND);
+        return false;
+    }
+    mBufferUsed = 0;
+    mOffset = 0;
+    mFirstBatch = true;
+    mDone = false;
+    return true;
+}
+
+bool DirEnumerator::FetchBatch()
+{
+    IO_STATUS_BLOCK ioStatus;
+    NTSTATUS status = NtQueryDirectoryFile(mHandle, NULL, NULL, NULL, &ioStatus, mBuffer, DIR_ENUM_BUFFER_SIZE,
+        FileDirectoryInformation, NULL, mFirstBatch ? TRUE : FALSE);
+    mFirstBatch = false;
+    if (status != STATUS_SUCCESS || ioStatus.Information == 0)
+    {
+        /* STATUS_NO_MORE_FILES ends the listing; any other failure ends it early */
+        mDone = true;
+        return false;
+    }
+    mBufferUsed = ioStatus.Information;
+    mOffset = 0;
+    return true;
+}
+
+bool DirEnumerator::Next(DirEnumEntry& entry)
+{
+    while (!mDone)
+    {
+        if (mOffset >= mBufferUsed && !FetchBatch())
+        {
+            return false;
+        }
+        const FILE_DIRECTORY_INFORMATION* info = (const FILE_DIRECTORY_INFORMATION*)(mBuffer + mOffset);
+        mOffset = (info->NextEntryOffset == 0) ? mBufferUsed : mOffset + info->NextEntryOffset;
+
+        size_t length = info->FileNameLength;
+        if (length >= sizeof(mName))
+        {
+            length = sizeof(mName) - 1;
+        }
+        if (IsDotEntry(info->FileName, length))
+        {
+            continue;
+        }
+        memcpy(mName, info->FileName, length);
+        mName[length] = 0;
+
+        entry.name = mName;
+        entry.nameLength = length;
+        entry.attributes = info->FileAttributes;
+        entry.isDir = (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry.size = (unsigned __int64)info->EndOfFile.QuadPart;
+        entry.lastWriteTime.dwLowDateTime = info->LastWriteTime.LowPart;
+        entry.lastWriteTime.dwHighDateTime = (DWORD)info->LastWriteTime.HighPart;
+        return true;
+    }
+    return false;
+}
+
+void DirEnumerator::Close()
+{
+    if (mHandle != NULL)
+    {
+        NtClose(mHandle);
+        mHandle = NULL;
+    }
+    mDone = true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "External.h"
+
+#include <string>
+
+/** One entry from DirEnumerator::Next; name is only valid until the next call. */
+struct DirEnumEntry
+{
+    const char* name;
+    size_t nameLength;
+    bool isDir;
+    DWORD attributes;
+    unsigned __int64 size;
+    FILETIME lastWriteTime;
+};
+
+/** Lists a directory in large batches (one NtQueryDirectoryFile call per 64 KB of entries). Skips "." and "..". */
+class DirEnumerator
+{
+public:
+    DirEnumerator();
+    ~DirEnumerator();
+
+    /** Open an API path (e.g. "HDD0-E:\Games"). Returns false if it cannot be listed; see WasNotFound. */
+    bool Open(const std::string& apiPath);
+    /** Fetch the next entry; returns false at the end of the directory or on error. */
+    bool Next(DirEnumEntry& entry);
+    void Close();
+    /** True if the last Open failed because the path does not exist. */
+    bool WasNotFound() const;
+
+private:
+    DirEnumerator(const DirEnumerator&);
+    DirEnumerator& operator=(const DirEnumerator&);
+
+    bool FetchBatch();
+
+    HANDLE mHandle;
+    uint8_t* mBuffer;
+    ULONG mBufferUsed;       /* bytes returned by the last batch */
+    ULONG mOffset;           /* offset of the next record in mBuffer */
+    bool mFirstBatch;
+    bool mDone;
+    bool mNotFound;
+    std::string mPath;
+    char mName[256];
+};
@@ -0,0 +1,234 @@
+#include "DirTree.h"
+#include "StatCache.h"
+#include "String.h"
+
+#include <vector>
+
+#define DIR_TREE_FILE_BATCH 256
+#define DIR_TREE_PROGRESS_DELAY_MS 500
+#define DIR_TREE_PROGRESS_INTERVAL_MS 250
+
+namespace
+{
+    /** A directory on the walk stack; its path is its parent's path plus name. */
+    struct DirTreeFrame
+    {
+        std::string name;
+        size_t depth;
+        bool listed;        /* files visited and subdirectories pushed; leave the directory when it is on top again */
+    };
+
+    /** DirTree::Remove: files are deleted in batches, each directory once everything below it is gone. */
+    class TreeRemover : public DirTreeVisitor
+    {
+    public:
+        TreeRemover(bool removeFiles, OutputSink* output)
+            : mRemoveFiles(removeFiles), mOutput(output), mStart(GetTickCount()), mLastPrint(0), mShown(false), mDirs(0), mFiles(0)
+        {
+        }
+
+        virtual bool OnFile(const std::string& path, const DirEnumEntry& entry)
+        {
+            if (!mRemoveFiles)
+            {
+                mResult = "The directory is not empty.\n";
+                return false;
+            }
+            mBatch.push_back(path);
+            return mBatch.size() < DIR_TREE_FILE_BATCH || DeleteBatch();
+        }
+
+        virtual bool OnListed(const std::string& dirPath)
+        {
+            return mBatch.empty() || DeleteBatch();
+        }
+
+        virtual bool OnLeave(const std::string& dirPath)
+        {
+            mResult = DirTree::RemoveEmptyDir(dirPath);
+            if (!mResult.empty())
+            {
+                return false;
+            }
+            mDirs++;
+            PrintProgress(false);
+            return true;
+        }
+
+        std::string Finish()
+        {
+            if (mShown)
+            {
+                if (mResult.empty())
+                {
+                    PrintProgress(true);
+                }
+                mOutput->Write("\n");
+            }
+            return mResult;
+        }
+
+    private:
+        bool DeleteBatch()
+        {
+            for (size_t i = 0; i < mBatch.size(); i++)
+            {
+                if (!DeleteFileA(mBatch[i].c_str()))
+                {
+                    DWORD e = GetLastError();
+                    mResult = (e == ERROR_PATH_NOT_FOUND) ? "The system cannot find the path specified.\n" : "Unable to delete file.\n";
+                    return false;
+                }
+                mFiles++;
+            }
+            mBatch.clear();
+            PrintProgress(false);
+            return true;
+        }
+
+        void PrintProgress(bool finished)
+        {
+            if (mOutput == NULL)
+            {
+                return;
+            }
+            DWORD now = GetTickCount();
+            if (!finished && ((DWORD)(now - mStart) < DIR_TREE_PROGRESS_DELAY_MS || (mShown && (DWORD)(now - mLastPrint) < DIR_TREE_PROGRESS_INTERVAL_MS)))
+            {
+                return;
+            }
+            DWORD elapsed = now - mStart;
+            if (elapsed == 0)
+            {
+                elapsed = 1;
+            }
+            double seconds = (double)elapsed / 1000.0;
+            mOutput->Write(String::Format("\r%lu dir(s), %lu file(s) removed  %.0f dirs/s  %.0f files/s   ",
+                mDirs, mFiles, (double)mDirs / seconds, (double)mFiles / seconds));
+            mLastPrint = now;
+            mShown = true;
+        }
+
+        bool mRemoveFiles;
+        OutputSink* mOutput;
+        DWORD mStart;
+        DWORD mLastPrint;
+        bool mShown;
+        unsigned long mDirs;
+        unsigned long mFiles;
+        std::vector<std::string> mBatch;
+        std::string mResult;
+    };
+}
+
+bool DirTree::Walk(const std::string& rootApi, bool recursive, DirTreeVisitor& visitor)
+{
+    std::vector<DirTreeFrame> stack;
+    DirTreeFrame root;
+    root.name = rootApi;
+    root.depth = 0;
+    root.listed = false;
+    stack.push_back(root);
+
+    /* path is the directory of the frame on top; pathEnds[d] is where its depth-d ancestor's path ends */
+    std::string path;
+    std::vector<size_t> pathEnds;
+    std::vector<std::string> subdirs;
+    std::string filePath;
+    while (!stack.empty())
+    {
+        DirTreeFrame& top = stack.back();
+        size_t depth = top.depth;
+        path.erase(depth == 0 ? 0 : pathEnds[depth - 1]);
+        if (depth > 0 && path[path.length() - 1] != '\\')
+        {
+            path += "\\";
+        }
+        path += top.name;
+        pathEnds.resize(depth + 1);
+        pathEnds[depth] = path.length();
+
+        if (top.listed)
+        {
+            if (!visitor.OnLeave(path))
+            {
+                return false;
+            }
+            stack.pop_back();
+            continue;
+        }
+        top.listed = true;
+
+        subdirs.clear();
+        DirEnumerator dir;
+        if (dir.Open(path))
+        {
+            filePath = path;
+            if (filePath[filePath.length() - 1] != '\\')
+            {
+                filePath += "\\";
+            }
+            size_t prefixLength = filePath.length();
+            DirEnumEntry de;
+            while (dir.Next(de))
+            {
+                if (de.isDir)
+                {
+                    if (recursive)
+                    {
+                        subdirs.push_back(std::string(de.name, de.nameLength));
+                    }
+                    continue;
+                }
+                filePath.erase(prefixLength);
+                filePath.append(de.name, de.nameLength);
+                if (!visitor.OnFile(filePath, de))
+                {
+                    return false;
+                }
+            }
+            dir.Close();
+        }
+        if (!visitor.OnListed(path))
+        {
+            return false;
+        }
+        /* Pushed last to first so they come off the stack in listing order */
+        for (size_t i = subdirs.size(); i > 0; i--)
+        {
+            DirTreeFrame child;
+            child.name = subdirs[i - 1];
+            child.depth = depth + 1;
+            child.listed = false;
+            stack.push_back(child);
+        }
+    }
+    return true;
+}
+
+std::string DirTree::RemoveEmptyDir(const std::string& apiPath)
+{
+    if (!RemoveDirectoryA(apiPath.c_str()))
+    {
+        DWORD err = GetLastError();
+        if (err == ERROR_DIR_NOT_EMPTY)
+        {
+            return "The directory is not empty.\n";
+        }
+        if (err == ERROR_PATH_NOT_FOUND)
+        {
+            return "The system cannot find the path specified.\n";
+        }
+        return "Unable to remove directory.\n";
+    }
+    StatCache::Invalidate(apiPath);
+    return "";
+}
+
+std::string DirTree::Remove(const std::string& apiPath, bool removeFiles, OutputSink* output)
+{
+    TreeRemover remover(removeFiles, output);
+    Walk(apiPath, true, remover);
+    StatCache::Invalidate(apiPath);
+    return remover.Finish();
+}
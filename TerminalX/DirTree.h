@@ -0,0 +1,34 @@
+#pragma once
+
+#include "External.h"
+#include "DirEnumerator.h"
+#include "OutputSink.h"
+
+#include <string>
+
+/** Callbacks for DirTree::Walk; returning false from any of them ends the walk. */
+class DirTreeVisitor
+{
+public:
+    virtual ~DirTreeVisitor() {}
+    /** A file in the directory being listed; path is its full API path. The listing is still open. */
+    virtual bool OnFile(const std::string& path, const DirEnumEntry& entry) = 0;
+    /** dirPath has been listed and its listing closed; its subdirectories are visited next. */
+    virtual bool OnListed(const std::string& dirPath) { return true; }
+    /** Everything below dirPath has been visited. */
+    virtual bool OnLeave(const std::string& dirPath) { return true; }
+};
+
+/** Depth-first directory tree walks with an explicit work stack, so stack and handle use stay flat however deep the tree is. */
+class DirTree
+{
+public:
+    /** Visit rootApi (e.g. "HDD0-E:\Games") and, if recursive, every directory below it in listing order. Each listing is closed before its subdirectories are visited and a frame holds only a name. Returns false if a visitor callback stopped the walk. */
+    static bool Walk(const std::string& rootApi, bool recursive, DirTreeVisitor& visitor);
+
+    /** Remove apiPath and everything below it, deleting files in batches of DIR_TREE_FILE_BATCH. With removeFiles false any file left in the tree stops it with "The directory is not empty.". Removals that run longer than half a second write a "\r" dirs/s and files/s line to output if it is not NULL. Returns empty or error message */
+    static std::string Remove(const std::string& apiPath, bool removeFiles, OutputSink* output);
+
+    /** Remove one empty directory. Returns empty or error message */
+    static std::string RemoveEmptyDir(const std::string& apiPath);
+};
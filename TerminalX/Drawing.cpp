@@ -1,22 +1,9 @@
 #include "Drawing.h"
 #include "Resources.h"
 #include "TerminalBuffer.h"
-#include <map>
-
-#define SSFN_IMPLEMENTATION
-#define SFFN_MAXLINES 8192
-#define SSFN_memcmp memcmp
-#define SSFN_memset memset
-#define SSFN_realloc realloc
-#define SSFN_free free
-#include "ssfn.h"
-
-typedef struct {
-    int x;
-    int y;
-    int width;
-    int height;
-} recti;
+#include "Debug.h"
+#include "Swizzler.h"
+#include "GlyphCache.h"
 
 typedef struct {
     float x;
@@ -25,8 +12,10 @@ typedef struct {
     float height;
 } rectf;
 
-#define FONT_TEXTURE_DIMENSION 1024
-#define DRAW_BATCH_MAX_VERTS 8190
+/* Each cell is one 4-vertex quad drawn through the shared index list (2 triangles, 6 indices) */
+#define QUAD_VERTS 4
+#define QUAD_INDICES 6
+#define DRAW_BATCH_MAX_QUADS 2047
 
 /* One vertex for terminal batch: XYZ + diffuse + UV (matches D3DFVF_XYZ|D3DFVF_DIFFUSE|D3DFVF_TEX1) */
 struct terminal_vertex_t {
@@ -37,19 +26,100 @@ struct terminal_vertex_t {
 
 namespace
 {
-	ssfn_t* mFontContext = NULL;
     LPDIRECT3DDEVICE8 mD3dDevice;
     static DWORD s_bufferWidth;
     static DWORD s_bufferHeight;
 
-    std::map<uint32_t, recti> charMap;
-    recti s_charRects[256];
+    /* Quads packed row after row; row r owns [rowStart[r], rowStart[r] + rowCount[r]) */
+    struct RowQuadCache
+    {
+        terminal_vertex_t* verts;
+        int rowStart[TERMINAL_MAX_ROWS];
+        int rowCount[TERMINAL_MAX_ROWS];
+        int totalQuads;
+    };
+
+    RowQuadCache s_glyphCache;       /* textured glyph quads */
+    RowQuadCache s_backgroundCache;  /* untextured quads for runs of non-default background */
+    terminal_vertex_t* s_rowScratch = NULL;
+    int s_terminalVertCells = 0;
+    bool s_rowCacheValid = false;
+    const char* s_cachedBuffer = NULL;
+    const unsigned char* s_cachedAttrs = NULL;
+    uint32_t s_cachedColor = 0;
+    uint32_t s_cachedBackground = 0;
+    uint32_t s_lastFrameVertexBytes = 0;
+    WORD s_quadIndices[DRAW_BATCH_MAX_QUADS * QUAD_INDICES];
+    bool s_quadIndicesBuilt = false;
+}
 
-    int texture_width;
-    int texture_height;
-    D3DTexture* font_texture;
+static void BuildQuadIndices()
+{
+    if (s_quadIndicesBuilt)
+    {
+        return;
+    }
+    /* Quad corners are 0=right/top 1=right/bottom 2=left/bottom 3=left/top (same winding as the old triangle list) */
+    for (int q = 0; q < DRAW_BATCH_MAX_QUADS; q++)
+    {
+        WORD base = (WORD)(q * QUAD_VERTS);
+        WORD* idx = &s_quadIndices[q * QUAD_INDICES];
+        idx[0] = base;
+        idx[1] = (WORD)(base + 1);
+        idx[2] = (WORD)(base + 2);
+        idx[3] = base;
+        idx[4] = (WORD)(base + 2);
+        idx[5] = (WORD)(base + 3);
+    }
+    s_quadIndicesBuilt = true;
+}
 
-    static terminal_vertex_t s_terminalVerts[TERMINAL_MAX_VERTS];
+static void SetQuad(terminal_vertex_t* v, float px, float py, float fw, float fh, DWORD color, float u0, float v0, float u1, float v1)
+{
+    v[0].x = px + fw;
+    v[0].y = py + fh;
+    v[0].z = 0.0f;
+    v[0].diffuse = color;
+    v[0].u = u1;
+    v[0].v = v0;
+    v[1].x = px + fw;
+    v[1].y = py;
+    v[1].z = 0.0f;
+    v[1].diffuse = color;
+    v[1].u = u1;
+    v[1].v = v1;
+    v[2].x = px;
+    v[2].y = py;
+    v[2].z = 0.0f;
+    v[2].diffuse = color;
+    v[2].u = u0;
+    v[2].v = v1;
+    v[3].x = px;
+    v[3].y = py + fh;
+    v[3].z = 0.0f;
+    v[3].diffuse = color;
+    v[3].u = u0;
+    v[3].v = v0;
+}
+
+static void DrawQuads(const terminal_vertex_t* verts, int quadCount)
+{
+    for (int offset = 0; offset < quadCount; )
+    {
+        int batchQuads = quadCount - offset;
+        if (batchQuads > DRAW_BATCH_MAX_QUADS)
+            batchQuads = DRAW_BATCH_MAX_QUADS;
+        mD3dDevice->DrawIndexedPrimitiveUP(
+            D3DPT_TRIANGLELIST,
+            0,
+            batchQuads * QUAD_VERTS,
+            batchQuads * 2,
+            s_quadIndices,
+            D3DFMT_INDEX16,
+            verts + (offset * QUAD_VERTS),
+            sizeof(terminal_vertex_t));
+        offset += batchQuads;
+    }
 }
 
 void Drawing::SetD3dDevice(LPDIRECT3DDEVICE8 d3dDevice) {
@@ -78,285 +148,256 @@ DWORD Drawing::GetBufferHeight() {
 
 void Drawing::Swizzle(const void* src, const uint32_t& depth, const uint32_t& width, const uint32_t& height, void* dest)
 {
-  for (UINT y = 0; y < height; y++)
-  {
-    UINT sy = 0;
-    if (y < width)
+    Swizzler::Swizzle(src, width * depth, depth, width, height, dest);
+}
+
+void Drawing::GenerateBitmapFont()
+{
+    DWORD startTick = GetTickCount();
+    if (GlyphCache::Init(mD3dDevice))
+    {
+        Debug::Print("Font: glyph cache ready in %u ms\n", (unsigned int)(GetTickCount() - startTick));
+    }
+}
+
+void Drawing::Init()
+{
+    GenerateBitmapFont();
+}
+
+void Drawing::DrawTerminal(const char* buffer, uint32_t color)
+{
+    DrawTerminal(buffer, NULL, NULL, color, -1, -1, false);
+}
+
+void Drawing::DrawTerminal(const char* buffer, uint32_t color, int cursorX, int cursorY, bool cursorVisible)
+{
+    DrawTerminal(buffer, NULL, NULL, color, cursorX, cursorY, cursorVisible);
+}
+
+/** Foreground color for a cell attribute (TERMINAL_ATTR_DEFAULT = the frame's text color). */
+static uint32_t AttrForeground(unsigned char attr, uint32_t color)
+{
+    return (attr == TERMINAL_ATTR_DEFAULT) ? color : TerminalBuffer::GetPaletteColor(attr & 0x0F);
+}
+
+/** Background color for a cell attribute (TERMINAL_ATTR_DEFAULT or a TERMINAL_ATTR_FOREGROUND one = the frame's clear color). */
+static uint32_t AttrBackground(unsigned char attr, uint32_t background)
+{
+    return ((attr >> 4) == (attr & 0x0F)) ? background : TerminalBuffer::GetPaletteColor(attr >> 4);
+}
+
+/** Generate the glyph quads for one row into out; returns the number of quads written. */
+static int BuildRowQuads(const char* rowChars, const unsigned char* rowAttrs, int row, int cols, uint32_t color, terminal_vertex_t* out)
+{
+    const int cellW = TERMINAL_FONT_SIZE_WIDTH;
+    const int cellH = TERMINAL_FONT_SIZE_HEIGHT;
+    const float invW = 1.0f / (float)GlyphCache::GetTextureWidth();
+    const float invH = 1.0f / (float)GlyphCache::GetTextureHeight();
+    const float py = (float)Drawing::GetBufferHeight() - ((float)((row + 1) * cellH)) - 0.5f;
+    int nQuads = 0;
+    for (int col = 0; col < cols; col++)
     {
-      for (int bit = 0; bit < 16; bit++)
-        sy |= ((y >> bit) & 1) << (2*bit);
-      sy <<= 1; // y counts twice
+        const GlyphRect* r = GlyphCache::Lookup(GlyphCache::UnicodeForByte((unsigned char)rowChars[col]));
+        if (r == NULL || r->width == 0 || r->height == 0)
+            continue;
+        float u0 = r->x * invW;
+        float v0 = r->y * invH;
+        float u1 = (r->x + r->width) * invW;
+        float v1 = (r->y + r->height) * invH;
+        float px = (float)(col * cellW) - 0.5f;
+        uint32_t cellColor = (rowAttrs != NULL) ? AttrForeground(rowAttrs[col], color) : color;
+        SetQuad(out, px, py, (float)cellW, (float)cellH, cellColor, u0, v0, u1, v1);
+        out += QUAD_VERTS;
+        nQuads++;
     }
-    else
+    return nQuads;
+}
+
+/** Generate one quad per run of cells sharing a non-default background; returns the number of quads written. */
+static int BuildRowBackgroundQuads(const unsigned char* rowAttrs, int row, int cols, uint32_t background, terminal_vertex_t* out)
+{
+    if (rowAttrs == NULL)
     {
-      UINT y_mask = y % width;
-      for (int bit = 0; bit < 16; bit++)
-        sy |= ((y_mask >> bit) & 1) << (2*bit);
-      sy <<= 1; // y counts twice
-      sy += (y / width) * width * width;
+        return 0;
     }
-    BYTE *s = (BYTE *)src + y * width * depth;
-    for (UINT x = 0; x < width; x++)
+    const int cellW = TERMINAL_FONT_SIZE_WIDTH;
+    const int cellH = TERMINAL_FONT_SIZE_HEIGHT;
+    const float py = (float)Drawing::GetBufferHeight() - ((float)((row + 1) * cellH)) - 0.5f;
+    int nQuads = 0;
+    int col = 0;
+    while (col < cols)
     {
-      UINT sx = 0;
-      if (x < height * 2)
-      {
-        for (int bit = 0; bit < 16; bit++)
-          sx |= ((x >> bit) & 1) << (2*bit);
-      }
-      else
-      {
-        int x_mask = x % (2*height);
-        for (int bit = 0; bit < 16; bit++)
-          sx |= ((x_mask >> bit) & 1) << (2*bit);
-        sx += (x / (2 * height)) * 2 * height * height;
-      }
-      BYTE *d = (BYTE *)dest + (sx + sy)*depth;
-      for (unsigned int i = 0; i < depth; ++i)
-        *d++ = *s++;
+        uint32_t runColor = AttrBackground(rowAttrs[col], background);
+        int runStart = col;
+        col++;
+        while (col < cols && AttrBackground(rowAttrs[col], background) == runColor)
+        {
+            col++;
+        }
+        if (runColor == background)
+        {
+            continue;
+        }
+        float px = (float)(runStart * cellW) - 0.5f;
+        SetQuad(out, px, py, (float)((col - runStart) * cellW), (float)cellH, runColor, 0, 0, 0, 0);
+        out += QUAD_VERTS;
+        nQuads++;
     }
-  }
+    return nQuads;
 }
 
-void Drawing::CreateImage(uint8_t* imageData, D3DFORMAT format, int width, int height)
+/** Replace row's quads in cache with the n quads in scratch, shifting later rows so the cache stays packed for a single draw. */
+static void StoreRowQuads(RowQuadCache& cache, int row, int rows, const terminal_vertex_t* scratch, int n)
 {
-	if (FAILED(D3DXCreateTexture(mD3dDevice, width, height, 1, 0, format, D3DPOOL_DEFAULT, &font_texture)))
-	{
-		return;
-	}
-
-	D3DSURFACE_DESC surfaceDesc;
-	font_texture->GetLevelDesc(0, &surfaceDesc);
-
-	D3DLOCKED_RECT lockedRect;
-	if (SUCCEEDED(font_texture->LockRect(0, &lockedRect, NULL, 0)))
-	{
-		uint8_t* tempBuffer = (uint8_t*)malloc(surfaceDesc.Size);
-		memset(tempBuffer, 0, surfaceDesc.Size);
-		uint8_t* src = imageData;
-		uint8_t* dst = tempBuffer;
-		for (int32_t y = 0; y < height; y++)
-		{
-			memcpy(dst, src, width * 4);
-			src += width * 4;
-			dst += surfaceDesc.Width * 4;
-		}
-		Swizzle(tempBuffer, 4, surfaceDesc.Width, surfaceDesc.Height, lockedRect.pBits);
-		free(tempBuffer);
-		font_texture->UnlockRect(0);
-	}
+    int start = cache.rowStart[row];
+    int old = cache.rowCount[row];
+    if (n != old)
+    {
+        int tail = cache.totalQuads - (start + old);
+        memmove(cache.verts + ((start + n) * QUAD_VERTS),
+            cache.verts + ((start + old) * QUAD_VERTS),
+            (size_t)tail * QUAD_VERTS * sizeof(terminal_vertex_t));
+        for (int below = row + 1; below < rows; below++)
+            cache.rowStart[below] += n - old;
+        cache.totalQuads += n - old;
+        cache.rowCount[row] = n;
+    }
+    memcpy(cache.verts + (start * QUAD_VERTS), scratch, (size_t)n * QUAD_VERTS * sizeof(terminal_vertex_t));
 }
 
-void Drawing::GenerateBitmapFont()
+/** Bring the packed glyph and background caches up to date; returns the number of vertex bytes generated. */
+static uint32_t UpdateRowCache(const char* buffer, const unsigned char* attrs, const uint32_t* dirtyRows, uint32_t color, uint32_t background, int rows, int cols)
 {
-	if (mFontContext != NULL)
-	{
-        return;
+    uint32_t builtQuads = 0;
+    bool rebuildAll = !s_rowCacheValid || dirtyRows == NULL || buffer != s_cachedBuffer || attrs != s_cachedAttrs ||
+        color != s_cachedColor || background != s_cachedBackground;
+    if (rebuildAll)
+    {
+        s_glyphCache.totalQuads = 0;
+        s_backgroundCache.totalQuads = 0;
+        for (int row = 0; row < rows; row++)
+        {
+            const unsigned char* rowAttrs = (attrs != NULL) ? &attrs[row * cols] : NULL;
+            int n = BuildRowQuads(&buffer[row * cols], rowAttrs, row, cols, color, s_glyphCache.verts + (s_glyphCache.totalQuads * QUAD_VERTS));
+            s_glyphCache.rowStart[row] = s_glyphCache.totalQuads;
+            s_glyphCache.rowCount[row] = n;
+            s_glyphCache.totalQuads += n;
+            builtQuads += n;
+            n = BuildRowBackgroundQuads(rowAttrs, row, cols, background, s_backgroundCache.verts + (s_backgroundCache.totalQuads * QUAD_VERTS));
+            s_backgroundCache.rowStart[row] = s_backgroundCache.totalQuads;
+            s_backgroundCache.rowCount[row] = n;
+            s_backgroundCache.totalQuads += n;
+            builtQuads += n;
+        }
+        s_rowCacheValid = true;
+        s_cachedBuffer = buffer;
+        s_cachedAttrs = attrs;
+        s_cachedColor = color;
+        s_cachedBackground = background;
+        return builtQuads * QUAD_VERTS * sizeof(terminal_vertex_t);
+    }
+    uint32_t evictions = GlyphCache::GetEvictionCount();
+    for (int row = 0; row < rows; row++)
+    {
+        if ((dirtyRows[row >> 5] & (1u << (row & 31))) == 0)
+            continue;
+        const unsigned char* rowAttrs = (attrs != NULL) ? &attrs[row * cols] : NULL;
+        int n = BuildRowQuads(&buffer[row * cols], rowAttrs, row, cols, color, s_rowScratch);
+        StoreRowQuads(s_glyphCache, row, rows, s_rowScratch, n);
+        builtQuads += n;
+        n = BuildRowBackgroundQuads(rowAttrs, row, cols, background, s_rowScratch);
+        StoreRowQuads(s_backgroundCache, row, rows, s_rowScratch, n);
+        builtQuads += n;
+    }
+    if (GlyphCache::GetEvictionCount() != evictions)
+    {
+        /* A glyph cached by a clean row lost its slot: rebuild everything against the current rects */
+        s_rowCacheValid = false;
+        return UpdateRowCache(buffer, attrs, dirtyRows, color, background, rows, cols);
     }
+    return builtQuads * QUAD_VERTS * sizeof(terminal_vertex_t);
+}
 
-	mFontContext = (ssfn_t*)malloc(sizeof(ssfn_t)); 
-    if (mFontContext == NULL)
+void Drawing::ResizeTerminalGeometry(int rows, int cols)
+{
+    BuildQuadIndices();
+    int cells = (rows > 0 && cols > 0) ? rows * cols : 0;
+    if (cells == s_terminalVertCells && s_glyphCache.verts != NULL)
     {
         return;
     }
-	memset(mFontContext, 0, sizeof(ssfn_t));
-
-	if (ssfn_load(mFontContext, &terminal_sfn[0]) != 0)
+    if (s_glyphCache.verts != NULL)
+    {
+        free(s_glyphCache.verts);
+        free(s_backgroundCache.verts);
+        free(s_rowScratch);
+        s_glyphCache.verts = NULL;
+        s_backgroundCache.verts = NULL;
+        s_rowScratch = NULL;
+    }
+    s_terminalVertCells = 0;
+    s_rowCacheValid = false;
+    if (cells == 0)
     {
         return;
     }
-
-	ssfn_select(mFontContext, SSFN_FAMILY_ANY, "CascadiaCode", SSFN_STYLE_REGULAR, 32);
-
-	int textureWidth = FONT_TEXTURE_DIMENSION;
-	int textureHeight = FONT_TEXTURE_DIMENSION; 
-	uint32_t* imageData = (uint32_t*)malloc(textureWidth * textureHeight * 4);
-    if (imageData == NULL)
+    /* Each cell has at most one glyph quad and starts at most one background run */
+    s_glyphCache.verts = (terminal_vertex_t*)malloc((size_t)cells * QUAD_VERTS * sizeof(terminal_vertex_t));
+    s_backgroundCache.verts = (terminal_vertex_t*)malloc((size_t)cells * QUAD_VERTS * sizeof(terminal_vertex_t));
+    s_rowScratch = (terminal_vertex_t*)malloc((size_t)cols * QUAD_VERTS * sizeof(terminal_vertex_t));
+    if (s_glyphCache.verts == NULL || s_backgroundCache.verts == NULL || s_rowScratch == NULL)
     {
+        Debug::Print("Failed to allocate terminal geometry\n");
+        free(s_glyphCache.verts);
+        free(s_backgroundCache.verts);
+        free(s_rowScratch);
+        s_glyphCache.verts = NULL;
+        s_backgroundCache.verts = NULL;
+        s_rowScratch = NULL;
         return;
     }
-
-	memset(imageData, 0, textureWidth * textureHeight * 4);  
-
-	int x = 2;
-	int y = 2;
-
-	const char* charsToEncode =
-		" !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
-		//"\xE2\x94\x80\xE2\x94\x81\xE2\x94\x82\xE2\x94\x83\xE2\x94\x84\xE2\x94\x85\xE2\x94\x86\xE2\x94\x87\xE2\x94\x88\xE2\x94\x89\xE2\x94\x8A\xE2\x94\x8B\xE2\x94\x8C\xE2\x94\x8D\xE2\x94\x8E\xE2\x94\x8F"
-		//"\xE2\x94\x90\xE2\x94\x91\xE2\x94\x92\xE2\x94\x93\xE2\x94\x94\xE2\x94\x95\xE2\x94\x96\xE2\x94\x97\xE2\x94\x98\xE2\x94\x99\xE2\x94\x9A\xE2\x94\x9B\xE2\x94\x9C\xE2\x94\x9D\xE2\x94\x9E\xE2\x94\x9F"
-		//"\xE2\x94\xA0\xE2\x94\xA1\xE2\x94\xA2\xE2\x94\xA3\xE2\x94\xA4\xE2\x94\xA5\xE2\x94\xA6\xE2\x94\xA7\xE2\x94\xA8\xE2\x94\xA9\xE2\x94\xAA\xE2\x94\xAB\xE2\x94\xAC\xE2\x94\xAD\xE2\x94\xAE\xE2\x94\xAF"
-		//"\xE2\x94\xB0\xE2\x94\xB1\xE2\x94\xB2\xE2\x94\xB3\xE2\x94\xB4\xE2\x94\xB5\xE2\x94\xB6\xE2\x94\xB7\xE2\x94\xB8\xE2\x94\xB9\xE2\x94\xBA\xE2\x94\xBB\xE2\x94\xBC\xE2\x94\xBD\xE2\x94\xBE\xE2\x94\xBF"
-		//"\xE2\x95\x80\xE2\x95\x81\xE2\x95\x82\xE2\x95\x83\xE2\x95\x84\xE2\x95\x85\xE2\x95\x86\xE2\x95\x87\xE2\x95\x88\xE2\x95\x89\xE2\x95\x8A\xE2\x95\x8B\xE2\x95\x8C\xE2\x95\x8D\xE2\x95\x8E\xE2\x95\x8F"
-		//"\xE2\x95\x90\xE2\x95\x91\xE2\x95\x92\xE2\x95\x93\xE2\x95\x94\xE2\x95\x95\xE2\x95\x96\xE2\x95\x97\xE2\x95\x98\xE2\x95\x99\xE2\x95\x9A\xE2\x95\x9B\xE2\x95\x9C\xE2\x95\x9D\xE2\x95\x9E\xE2\x95\x9F"
-		//"\xE2\x95\xA0\xE2\x95\xA1\xE2\x95\xA2\xE2\x95\xA3\xE2\x95\xA4\xE2\x95\xA5\xE2\x95\xA6\xE2\x95\xA7\xE2\x95\xA8\xE2\x95\xA9\xE2\x95\xAA\xE2\x95\xAB\xE2\x95\xAC\xE2\x95\xAD\xE2\x95\xAE\xE2\x95\xAF"
-		//"\xE2\x95\xB0\xE2\x95\xB1\xE2\x95\xB2\xE2\x95\xB3\xE2\x95\xB4\xE2\x95\xB5\xE2\x95\xB6\xE2\x95\xB7\xE2\x95\xB8\xE2\x95\xB9\xE2\x95\xBA\xE2\x95\xBB\xE2\x95\xBC\xE2\x95\xBD\xE2\x95\xBE\xE2\x95\xBF";
-	
-    char* currentCharPos = const_cast<char*>(charsToEncode);
-	while(*currentCharPos)
-	{	
-		char* nextCharPos = currentCharPos;
-		uint32_t unicode = ssfn_utf8(&nextCharPos);
-
-		int32_t length = nextCharPos - currentCharPos;
-		char* currentChar = (char*)malloc(length + 1);
-		memcpy(currentChar, currentCharPos, length);
-		currentChar[length] = 0;
-
-		currentCharPos = nextCharPos;
-
-        int bounds_x;
-        int bounds_y;
-        int bounds_width;
-        int bounds_height;
-        int ret = ssfn_bbox(mFontContext, currentChar, &bounds_width, &bounds_height, &bounds_x, &bounds_y);
-		if (ret != 0)
-		{
-			continue;
-		}
-
-		if ((x + bounds_width + 2) > textureWidth)
-		{
-			x = 2;
-			y = y + bounds_height + 2;
-		}
-
-		recti* rect = &charMap[unicode];
-		rect->x = x;
-		rect->y = y;
-		rect->width = bounds_width;
-		rect->height = bounds_height;
-
-		ssfn_buf_t buffer; 
-		memset(&buffer, 0, sizeof(buffer));
-		buffer.ptr = (uint8_t*)imageData;
-		buffer.x = x + bounds_x;
-		buffer.y = y + bounds_y;
-		buffer.w = textureWidth;
-		buffer.h = textureHeight;
-		buffer.p = textureWidth * 4;
-		buffer.bg = 0;                                  /* transparent so texture has proper alpha mask */
-		buffer.fg = 0xffffffff;                         /* white; SSFN writes coverage into alpha */   
-
-		ssfn_render(mFontContext, &buffer, currentChar);
-
-		x = x + bounds_width + 2;   
-		free(currentChar);
-	}
-
-	for (int i = 0; i < 256; i++)
-	{
-		std::map<uint32_t, recti>::iterator it = charMap.find((uint32_t)i);
-		if (it != charMap.end())
-			s_charRects[i] = it->second;
-		else
-			s_charRects[i].x = s_charRects[i].y = s_charRects[i].width = s_charRects[i].height = 0;
-	}
-
-	CreateImage((uint8_t*)imageData, D3DFMT_A8R8G8B8, textureWidth, textureHeight);
-	free(imageData);
+    s_terminalVertCells = cells;
+    Debug::Print("Terminal geometry %dx%d: %u vertex bytes\n", cols, rows, (unsigned int)(cells * 2 * QUAD_VERTS * sizeof(terminal_vertex_t)));
 }
 
-void Drawing::Init()
+uint32_t Drawing::GetLastFrameVertexBytes()
 {
-    GenerateBitmapFont();
+    return s_lastFrameVertexBytes;
 }
 
-void Drawing::DrawTerminal(const char* buffer, uint32_t color)
-{
-    DrawTerminal(buffer, color, -1, -1, false);
-}
-
-void Drawing::DrawTerminal(const char* buffer, uint32_t color, int cursorX, int cursorY, bool cursorVisible)
+void Drawing::DrawTerminal(const char* buffer, const unsigned char* attrs, const uint32_t* dirtyRows, uint32_t color, int cursorX, int cursorY, bool cursorVisible)
 {
     const int cellW = TERMINAL_FONT_SIZE_WIDTH;
     const int cellH = TERMINAL_FONT_SIZE_HEIGHT;
     const float bufH = (float)Drawing::GetBufferHeight();
-    const float invDim = 1.0f / (float)FONT_TEXTURE_DIMENSION;
     const int rows = TerminalBuffer::GetRows();
     const int cols = TerminalBuffer::GetCols();
+    const uint32_t background = TerminalBuffer::GetBackgroundColor();
 
-    terminal_vertex_t* v = s_terminalVerts;
-    int nVerts = 0;
+    ResizeTerminalGeometry(rows, cols);
 
-    for (int row = 0; row < rows; row++)
+    s_lastFrameVertexBytes = 0;
+    if (s_glyphCache.verts != NULL && rows <= TERMINAL_MAX_ROWS)
     {
-        for (int col = 0; col < cols; col++)
-        {
-            unsigned char uc = (unsigned char)buffer[(row * cols) + col];
-            const recti& r = s_charRects[uc];
-            if (r.width == 0 || r.height == 0)
-                continue;
-            float u0 = r.x * invDim;
-            float v0 = r.y * invDim;
-            float u1 = (r.x + r.width) * invDim;
-            float v1 = (r.y + r.height) * invDim;
-
-            float px = (float)(col * cellW) - 0.5f;
-            float py = bufH - ((float)((row + 1)  * cellH)) - 0.5f;
-            float pz = 0.0f;
-            float fw = (float)cellW;
-            float fh = (float)cellH;
-
-            v[0].x = px + fw;
-            v[0].y = py + fh;
-            v[0].z = pz;
-            v[0].diffuse = color;
-            v[0].u = u1;
-            v[0].v = v0;
-            v[1].x = px + fw;
-            v[1].y = py;
-            v[1].z = pz;
-            v[1].diffuse = color;
-            v[1].u = u1;
-            v[1].v = v1;
-            v[2].x = px;
-            v[2].y = py;
-            v[2].z = pz;
-            v[2].diffuse = color;
-            v[2].u = u0;
-            v[2].v = v1;
-            v[3].x = px + fw;
-            v[3].y = py + fh;
-            v[3].z = pz;
-            v[3].diffuse = color;
-            v[3].u = u1;
-            v[3].v = v0;
-            v[4].x = px;
-            v[4].y = py;
-            v[4].z = pz;
-            v[4].diffuse = color;
-            v[4].u = u0;
-            v[4].v = v1;
-            v[5].x = px;
-            v[5].y = py + fh;
-            v[5].z = pz;
-            v[5].diffuse = color;
-            v[5].u = u0;
-            v[5].v = v0;
-            v += 6;
-            nVerts += 6;
-        }
+        GlyphCache::BeginFrame();
+        s_lastFrameVertexBytes = UpdateRowCache(buffer, attrs, dirtyRows, color, background, rows, cols);
+        GlyphCache::EndFrame();
     }
 
     mD3dDevice->BeginScene();
-    mD3dDevice->Clear(0L, NULL, D3DCLEAR_TARGET|D3DCLEAR_ZBUFFER|D3DCLEAR_STENCIL, TerminalBuffer::GetBackgroundColor(), 1.0f, 0L);
+    mD3dDevice->Clear(0L, NULL, D3DCLEAR_TARGET|D3DCLEAR_ZBUFFER|D3DCLEAR_STENCIL, background, 1.0f, 0L);
 
-    if (nVerts > 0)
+    /* All background runs untextured, then every glyph in one textured pass */
+    if (s_rowCacheValid && s_backgroundCache.totalQuads > 0)
     {
-        mD3dDevice->SetTexture(0, font_texture);
-        for (int offset = 0; offset < nVerts; )
-        {
-            int batchVerts = nVerts - offset;
-            if (batchVerts > DRAW_BATCH_MAX_VERTS)
-                batchVerts = DRAW_BATCH_MAX_VERTS;
-            mD3dDevice->DrawPrimitiveUP(
-                D3DPT_TRIANGLELIST,
-                batchVerts / 3,
-                s_terminalVerts + offset,
-                sizeof(terminal_vertex_t));
-            offset += batchVerts;
-        }
+        mD3dDevice->SetTexture(0, NULL);
+        DrawQuads(s_backgroundCache.verts, s_backgroundCache.totalQuads);
+    }
+    if (s_rowCacheValid && s_glyphCache.totalQuads > 0)
+    {
+        mD3dDevice->SetTexture(0, GlyphCache::GetTexture());
+        DrawQuads(s_glyphCache.verts, s_glyphCache.totalQuads);
     }
 
     /* Blinking cursor: block at (cursorX, cursorY) */
@@ -364,20 +405,10 @@ void Drawing::DrawTerminal(const char* buffer, uint32_t color, int cursorX, int
     {
         float px = (float)(cursorX * cellW) - 0.5f;
         float py = bufH - ((float)((cursorY + 1) * cellH)) - 0.5f;
-        float pz = 0.0f;
-        float fw = (float)cellW;
-        float fh = (float)cellH;
-        DWORD cursorColor = color;
-
-        struct { float x, y, z; DWORD diffuse; float u, v; } curV[6];
-        curV[0].x = px + fw; curV[0].y = py + fh; curV[0].z = pz; curV[0].diffuse = cursorColor; curV[0].u = 0; curV[0].v = 0;
-        curV[1].x = px + fw; curV[1].y = py;     curV[1].z = pz; curV[1].diffuse = cursorColor; curV[1].u = 0; curV[1].v = 0;
-        curV[2].x = px;       curV[2].y = py;     curV[2].z = pz; curV[2].diffuse = cursorColor; curV[2].u = 0; curV[2].v = 0;
-        curV[3].x = px + fw; curV[3].y = py + fh; curV[3].z = pz; curV[3].diffuse = cursorColor; curV[3].u = 0; curV[3].v = 0;
-        curV[4].x = px;       curV[4].y = py;     curV[4].z = pz; curV[4].diffuse = cursorColor; curV[4].u = 0; curV[4].v = 0;
-        curV[5].x = px;       curV[5].y = py + fh; curV[5].z = pz; curV[5].diffuse = cursorColor; curV[5].u = 0; curV[5].v = 0;
+        terminal_vertex_t curV[QUAD_VERTS];
+        SetQuad(curV, px, py, (float)cellW, (float)cellH, color, 0, 0, 0, 0);
         mD3dDevice->SetTexture(0, NULL);
-        mD3dDevice->DrawPrimitiveUP(D3DPT_TRIANGLELIST, 2, curV, sizeof(curV[0]));
+        DrawQuads(curV, 1);
     }
 
     mD3dDevice->EndScene();
@@ -17,9 +17,14 @@ public:
     static DWORD GetBufferHeight();
 
     static void Swizzle(const void* src, const uint32_t& depth, const uint32_t& width, const uint32_t& height, void* dest);
-    static void CreateImage(uint8_t* imageData, D3DFORMAT format, int width, int height);
     static void GenerateBitmapFont();
     static void Init();
+    /** (Re)allocate terminal vertex storage for a rows x cols grid. Call after the display mode is set. */
+    static void ResizeTerminalGeometry(int rows, int cols);
+    /** Vertex bytes generated by the last DrawTerminal call (0 when every row came from the cache). */
+    static uint32_t GetLastFrameVertexBytes();
     static void DrawTerminal(const char* buffer, uint32_t color);
     static void DrawTerminal(const char* buffer, uint32_t color, int cursorX, int cursorY, bool cursorVisible);
+    /** Draw with the per-row vertex cache: only rows set in dirtyRows are regenerated (NULL = all rows). attrs NULL = every cell in color. */
+    static void DrawTerminal(const char* buffer, const unsigned char* attrs, const uint32_t* dirtyRows, uint32_t color, int cursorX, int cursorY, bool cursorVisible);
 };
@@ -1,4 +1,5 @@
 #include "DriveMount.h"
+#include "DirCache.h"
 #include "External.h"
 #include "String.h"
 #include "InputManager.h"
@@ -6,6 +7,10 @@
 #include <string.h>
 #include <string>
 #include <map>
+#include <vector>
+
+#define DRIVE_PROBE_THREADS 4
+#define DRIVE_PROBE_STACK_SIZE (64 * 1024)
 
 enum DriveKind
 {
@@ -14,64 +19,97 @@ enum DriveKind
     DriveKindMemoryUnit
 };
 
+struct DriveTableRow
+{
+    const char* name;
+    DriveKind kind;
+    const char* devicePath;
+};
+
 struct DriveEntry
 {
     std::string name;
     DriveKind kind;
     std::string devicePath;
     bool mounted;
+    bool ready;                  /* last DoMount succeeded and nothing has unmounted the drive since */
+    unsigned long ejectCount;    /* CD-ROM: SMC tray eject count when ready was set */
+    CRITICAL_SECTION mountLock;  /* held while the drive is mounted, unmounted or probed */
+    DriveState state;            /* published probe result, guarded by s_stateLock */
+    unsigned __int64 totalBytes;
+    unsigned __int64 freeBytes;
 };
 
 typedef std::map<std::string, DriveEntry> DriveMap;
 
+namespace
+{
+    CRITICAL_SECTION s_stateLock;
+    std::vector<DriveEntry*> s_probeQueue;
+    volatile LONG s_probeNext = 0;
+    volatile LONG s_probeWorkers = 0;
+}
+
 static DriveMap& GetDrives()
 {
     static DriveMap s_drives;
     if (s_drives.empty())
     {
-        static const DriveEntry s_table[] =
+        static const DriveTableRow s_table[] =
         {
-            { "DVD-ROM",     DriveKindCdRom, "\\Device\\Cdrom0", false },
-            { "HDD0-C",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition2", false },
-            { "HDD0-E",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition1", false },
-            { "HDD0-F",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition6", false },
-            { "HDD0-G",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition7", false },
-            { "HDD0-H",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition8", false },
-            { "HDD0-I",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition9", false },
-            { "HDD0-J",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition10", false },
-            { "HDD0-K",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition11", false },
-            { "HDD0-L",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition12", false },
-            { "HDD0-M",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition13", false },
-            { "HDD0-N",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition14", false },
-            { "HDD0-X",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition3", false },
-            { "HDD0-Y",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition4", false },
-            { "HDD0-Z",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition5", false },
-            { "HDD1-C",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition2", false },
-            { "HDD1-E",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition1", false },
-            { "HDD1-F",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition6", false },
-            { "HDD1-G",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition7", false },
-            { "HDD1-H",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition8", false },
-            { "HDD1-I",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition9", false },
-            { "HDD1-J",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition10", false },
-            { "HDD1-K",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition11", false },
-            { "HDD1-L",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition12", false },
-            { "HDD1-M",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition13", false },
-            { "HDD1-N",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition14", false },
-            { "HDD1-X",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition3", false },
-            { "HDD1-Y",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition4", false },
-            { "HDD1-Z",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition5", false },
-            { "MMU0",        DriveKindMemoryUnit, "H", false },
-            { "MMU1",        DriveKindMemoryUnit, "I", false },
-            { "MMU2",        DriveKindMemoryUnit, "J", false },
-            { "MMU3",        DriveKindMemoryUnit, "K", false },
-            { "MMU4",        DriveKindMemoryUnit, "L", false },
-            { "MMU5",        DriveKindMemoryUnit, "M", false },
-            { "MMU6",        DriveKindMemoryUnit, "N", false },
-            { "MMU7",        DriveKindMemoryUnit, "O", false },
+            { "DVD-ROM",     DriveKindCdRom, "\\Device\\Cdrom0" },
+            { "HDD0-C",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition2" },
+            { "HDD0-E",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition1" },
+            { "HDD0-F",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition6" },
+            { "HDD0-G",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition7" },
+            { "HDD0-H",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition8" },
+            { "HDD0-I",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition9" },
+            { "HDD0-J",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition10" },
+            { "HDD0-K",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition11" },
+            { "HDD0-L",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition12" },
+            { "HDD0-M",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition13" },
+            { "HDD0-N",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition14" },
+            { "HDD0-X",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition3" },
+            { "HDD0-Y",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition4" },
+            { "HDD0-Z",      DriveKindHdd,   "\\Device\\Harddisk0\\Partition5" },
+            { "HDD1-C",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition2" },
+            { "HDD1-E",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition1" },
+            { "HDD1-F",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition6" },
+            { "HDD1-G",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition7" },
+            { "HDD1-H",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition8" },
+            { "HDD1-I",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition9" },
+            { "HDD1-J",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition10" },
+            { "HDD1-K",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition11" },
+            { "HDD1-L",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition12" },
+            { "HDD1-M",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition13" },
+            { "HDD1-N",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition14" },
+            { "HDD1-X",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition3" },
+            { "HDD1-Y",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition4" },
+            { "HDD1-Z",      DriveKindHdd,   "\\Device\\Harddisk1\\Partition5" },
+            { "MMU0",        DriveKindMemoryUnit, "H" },
+            { "MMU1",        DriveKindMemoryUnit, "I" },
+            { "MMU2",        DriveKindMemoryUnit, "J" },
+            { "MMU3",        DriveKindMemoryUnit, "K" },
+            { "MMU4",        DriveKindMemoryUnit, "L" },
+            { "MMU5",        DriveKindMemoryUnit, "M" },
+            { "MMU6",        DriveKindMemoryUnit, "N" },
+            { "MMU7",        DriveKindMemoryUnit, "O" },
         };
+        InitializeCriticalSection(&s_stateLock);
         for (size_t i = 0; i < sizeof(s_table) / sizeof(s_table[0]); i++)
         {
-            s_drives[s_table[i].name] = s_table[i];
+            /* Map nodes never move, so each entry's lock is initialised in place */
+            DriveEntry& ent = s_drives[s_table[i].name];
+            ent.name = s_table[i].name;
+            ent.kind = s_table[i].kind;
+            ent.devicePath = s_table[i].devicePath;
+            ent.mounted = false;
+            ent.ready = false;
+            ent.ejectCount = 0;
+            InitializeCriticalSection(&ent.mountLock);
+            ent.state = DriveStateUnknown;
+            ent.totalBytes = 0;
+            ent.freeBytes = 0;
         }
     }
     return s_drives;
@@ -103,8 +141,33 @@ static DriveEntry* FindDrive(const std::string& driveName)
     return &it->second;
 }
 
+static void Publish(DriveEntry* ent, DriveState state, unsigned __int64 totalBytes, unsigned __int64 freeBytes)
+{
+    EnterCriticalSection(&s_stateLock);
+    ent->state = state;
+    ent->totalBytes = totalBytes;
+    ent->freeBytes = freeBytes;
+    LeaveCriticalSection(&s_stateLock);
+}
+
+static bool ReadDiskSpace(const std::string& name, unsigned __int64& totalBytes, unsigned __int64& freeBytes)
+{
+    std::string path = String::Format("%s:\\", name.c_str());
+    ULARGE_INTEGER totalSpace;
+    ULARGE_INTEGER freeSpace;
+    totalSpace.QuadPart = 0;
+    freeSpace.QuadPart = 0;
+    bool ok = GetDiskFreeSpaceExA(path.c_str(), &freeSpace, &totalSpace, NULL) ? true : false;
+    totalBytes = totalSpace.QuadPart;
+    freeBytes = freeSpace.QuadPart;
+    return ok;
+}
+
+/* Mount and unmount run with ent->mountLock held. Only the CD-ROM remount reaches DoUnmount from DoMount, and the probe threads never remount it, so DirCache is only cleared on the main thread */
 static bool DoUnmount(DriveEntry* ent)
 {
+    DirCache::Clear();
+    ent->ready = false;
     if (ent->kind == DriveKindMemoryUnit)
     {
         return true;
@@ -134,9 +197,22 @@ static bool DoUnmount(DriveEntry* ent)
     {
         ent->mounted = false;
     }
+    Publish(ent, DriveStateUnknown, 0, 0);
     return (r == STATUS_SUCCESS);
 }
 
+static bool ReadTrayState(unsigned long& trayState, unsigned long& ejectCount)
+{
+    trayState = 0;
+    ejectCount = 0;
+    return HalReadSMCTrayState(&trayState, &ejectCount) == STATUS_SUCCESS;
+}
+
+static void PublishTrayState(DriveEntry* ent, unsigned long trayState)
+{
+    Publish(ent, trayState == SMC_TRAY_STATE_MEDIA_DETECT ? DriveStateReady : DriveStateAbsent, 0, 0);
+}
+
 static bool DoMount(DriveEntry* ent)
 {
     if (ent->kind == DriveKindMemoryUnit)
@@ -178,18 +254,59 @@ static bool DoMount(DriveEntry* ent)
 
     if (ent->kind == DriveKindCdRom)
     {
+        /* The link is good whether or not a disc is in; the eject count tells EnsureMounted when the media may have changed */
+        unsigned long trayState = 0;
+        ReadTrayState(trayState, ent->ejectCount);
+        PublishTrayState(ent, trayState);
+        ent->ready = true;
+        return true;
+    }
+
+    unsigned __int64 totalBytes = 0;
+    unsigned __int64 freeBytes = 0;
+    ent->ready = ReadDiskSpace(ent->name, totalBytes, freeBytes);
+    Publish(ent, ent->ready ? DriveStateReady : DriveStateAbsent, totalBytes, freeBytes);
+    return ent->ready;
+}
+
+static void ProbeDrive(DriveEntry* ent)
+{
+    EnterCriticalSection(&ent->mountLock);
+    if (ent->kind == DriveKindCdRom)
+    {
+        /* Only the tray is read; the disc is mounted when a command first uses it */
         unsigned long trayState = 0;
-        if (HalReadSMCTrayState(&trayState, NULL) == STATUS_SUCCESS && trayState == SMC_TRAY_STATE_MEDIA_DETECT)
+        unsigned long ejectCount = 0;
+        if (ReadTrayState(trayState, ejectCount))
         {
-            return true;
+            PublishTrayState(ent, trayState);
+        }
+        else
+        {
+            Publish(ent, DriveStateUnknown, 0, 0);
         }
-        return true;
     }
+    else if (!DoMount(ent))
+    {
+        Publish(ent, DriveStateAbsent, 0, 0);
+    }
+    LeaveCriticalSection(&ent->mountLock);
+}
 
-    std::string path = String::Format("%s:\\", ent->name.c_str());
-    ULARGE_INTEGER totalBytes;
-    totalBytes.QuadPart = 0;
-    return GetDiskFreeSpaceExA(path.c_str(), NULL, &totalBytes, NULL) ? true : false;
+static DWORD WINAPI ProbeThreadProc(LPVOID param)
+{
+    (void)param;
+    for (;;)
+    {
+        LONG index = InterlockedIncrement(&s_probeNext) - 1;
+        if (index >= (LONG)s_probeQueue.size())
+        {
+            break;
+        }
+        ProbeDrive(s_probeQueue[(size_t)index]);
+    }
+    InterlockedDecrement(&s_probeWorkers);
+    return 0;
 }
 
 bool DriveMount::Mount(std::string driveName)
@@ -199,7 +316,37 @@ bool DriveMount::Mount(std::string driveName)
     {
         return false;
     }
-    return DoMount(ent);
+    EnterCriticalSection(&ent->mountLock);
+    bool ok = DoMount(ent);
+    LeaveCriticalSection(&ent->mountLock);
+    return ok;
+}
+
+bool DriveMount::EnsureMounted(const std::string& driveName)
+{
+    DriveEntry* ent = FindDrive(driveName);
+    if (ent == NULL)
+    {
+        return false;
+    }
+    /* Waits only if a probe thread is busy with this same drive */
+    EnterCriticalSection(&ent->mountLock);
+    bool ok = true;
+    if (ent->kind == DriveKindMemoryUnit || !ent->ready)
+    {
+        ok = DoMount(ent);
+    }
+    else if (ent->kind == DriveKindCdRom)
+    {
+        unsigned long trayState = 0;
+        unsigned long ejectCount = 0;
+        if (!ReadTrayState(trayState, ejectCount) || ejectCount != ent->ejectCount)
+        {
+            ok = DoMount(ent);
+        }
+    }
+    LeaveCriticalSection(&ent->mountLock);
+    return ok;
 }
 
 bool DriveMount::Unmount(std::string driveName)
@@ -209,5 +356,88 @@ bool DriveMount::Unmount(std::string driveName)
     {
         return false;
     }
-    return DoUnmount(ent);
+    EnterCriticalSection(&ent->mountLock);
+    bool ok = DoUnmount(ent);
+    LeaveCriticalSection(&ent->mountLock);
+    return ok;
+}
+
+bool DriveMount::StartProbe()
+{
+    if (IsProbing())
+    {
+        return false;
+    }
+    DriveMap& drives = GetDrives();
+    s_probeQueue.clear();
+    for (DriveMap::iterator it = drives.begin(); it != drives.end(); ++it)
+    {
+        /* Memory units come and go with InputManager on the main thread, so GetDriveInfo reads them live */
+        if (it->second.kind == DriveKindMemoryUnit)
+        {
+            continue;
+        }
+        Publish(&it->second, DriveStatePending, 0, 0);
+        s_probeQueue.push_back(&it->second);
+    }
+    s_probeNext = 0;
+    int started = 0;
+    for (int i = 0; i < DRIVE_PROBE_THREADS; i++)
+    {
+        InterlockedIncrement(&s_probeWorkers);
+        HANDLE thread = CreateThread(NULL, DRIVE_PROBE_STACK_SIZE, ProbeThreadProc, NULL, 0, NULL);
+        if (thread == NULL)
+        {
+            InterlockedDecrement(&s_probeWorkers);
+            break;
+        }
+        CloseHandle(thread);
+        started++;
+    }
+    if (started == 0)
+    {
+        /* No thread to hand the work to; probe here rather than leave every drive pending */
+        InterlockedIncrement(&s_probeWorkers);
+        ProbeThreadProc(NULL);
+    }
+    return true;
+}
+
+bool DriveMount::IsProbing()
+{
+    /* An interlocked read, so the queue is only reused once the last worker is done with it */
+    return InterlockedCompareExchange(&s_probeWorkers, 0, 0) != 0;
+}
+
+void DriveMount::GetDriveInfo(std::vector<DriveInfo>& drives)
+{
+    drives.clear();
+    DriveMap& map = GetDrives();
+    for (DriveMap::iterator it = map.begin(); it != map.end(); ++it)
+    {
+        DriveEntry& ent = it->second;
+        DriveInfo info;
+        info.name = ent.name;
+        info.optical = (ent.kind == DriveKindCdRom);
+        info.state = DriveStateAbsent;
+        info.totalBytes = 0;
+        info.freeBytes = 0;
+        if (ent.kind == DriveKindMemoryUnit)
+        {
+            /* InputManager links a memory unit as its letter ("H:"), which devicePath holds */
+            if (InputManager::IsMemoryUnitMounted(ent.devicePath[0]) && ReadDiskSpace(ent.devicePath, info.totalBytes, info.freeBytes))
+            {
+                info.state = DriveStateReady;
+            }
+        }
+        else
+        {
+            EnterCriticalSection(&s_stateLock);
+            info.state = ent.state;
+            info.totalBytes = ent.totalBytes;
+            info.freeBytes = ent.freeBytes;
+            LeaveCriticalSection(&s_stateLock);
+        }
+        drives.push_back(info);
+    }
 }
@@ -3,10 +3,38 @@
 #include "External.h"
 
 #include <string>
+#include <vector>
+
+enum DriveState
+{
+    DriveStateUnknown,   /* never probed, or unmounted since */
+    DriveStatePending,   /* queued for the background probe */
+    DriveStateAbsent,    /* no such partition, no disc in the DVD drive, or no memory unit in the slot */
+    DriveStateReady
+};
+
+/** What the last probe or mount learned about one drive. */
+struct DriveInfo
+{
+    std::string name;
+    DriveState state;
+    bool optical;                /* DVD-ROM: Ready means a disc is in, and there are no sizes */
+    unsigned __int64 totalBytes;
+    unsigned __int64 freeBytes;
+};
 
 class DriveMount
 {
 public:
     static bool Mount(std::string driveName);
+    /** Mount driveName only if it is not already known to be mounted: hard disk partitions stay mounted until Unmount, the DVD until the tray is next opened. Memory units are always re-checked. */
+    static bool EnsureMounted(const std::string& driveName);
     static bool Unmount(std::string driveName);
+
+    /** Mount every hard disk partition and read the DVD tray on worker threads, returning at once; each drive's result is published as soon as it is known. Returns false if a probe is still running. */
+    static bool StartProbe();
+    /** True while probe threads are still working. */
+    static bool IsProbing();
+    /** Every drive in name order, from the published probe results; memory units are read live. Never waits on a probe. */
+    static void GetDriveInfo(std::vector<DriveInfo>& drives);
 };
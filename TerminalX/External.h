@@ -5,9 +5,13 @@
 
 #define FILE_SYNCHRONOUS_IO_NONALERT 0x00000020
 #define FILE_NON_DIRECTORY_FILE 0x00000040
+#define FILE_DIRECTORY_FILE 0x00000001
 #define OBJ_CASE_INSENSITIVE 0x00000040L
 #define SMC_TRAY_STATE_MEDIA_DETECT 1
 #define STATUS_SUCCESS 0
+#define STATUS_NO_MORE_FILES ((NTSTATUS)0x80000006L)
+#define STATUS_OBJECT_NAME_NOT_FOUND ((NTSTATUS)0xC0000034L)
+#define STATUS_OBJECT_PATH_NOT_FOUND ((NTSTATUS)0xC000003AL)
 
 #define SMBDEV_PIC16L 0x20
 #define PIC16L_CMD_POWER 0x02
@@ -46,6 +50,20 @@ typedef struct FILE_NETWORK_OPEN_INFORMATION {
 	ULONG FileAttributes;
 } FILE_NETWORK_OPEN_INFORMATION;
 
+typedef struct FILE_DIRECTORY_INFORMATION {
+	ULONG NextEntryOffset;
+	ULONG FileIndex;
+	LARGE_INTEGER CreationTime;
+	LARGE_INTEGER LastAccessTime;
+	LARGE_INTEGER LastWriteTime;
+	LARGE_INTEGER ChangeTime;
+	LARGE_INTEGER EndOfFile;
+	LARGE_INTEGER AllocationSize;
+	ULONG FileAttributes;
+	ULONG FileNameLength;
+	CHAR FileName[1];
+} FILE_DIRECTORY_INFORMATION;
+
 typedef enum FILE_INFORMATION_CLASS
 {
 	FileDirectoryInformation = 1,
@@ -123,6 +141,18 @@ extern "C" {
 		ULONG FileInformationLength,
 		FILE_INFORMATION_CLASS FileInformationClass
 	);
+    NTSTATUS WINAPI NtQueryDirectoryFile(
+		HANDLE FileHandle,
+		HANDLE Event,
+		PVOID ApcRoutine,
+		PVOID ApcContext,
+		IO_STATUS_BLOCK* IoStatusBlock,
+		PVOID FileInformation,
+		ULONG Length,
+		FILE_INFORMATION_CLASS FileInformationClass,
+		STRING* FileMask,
+		BOOLEAN RestartScan
+	);
     NTSTATUS WINAPI NtReadFile(
 		HANDLE Handle,
 		HANDLE Event,
@@ -1,10 +1,21 @@
 #include "FileSystem.h"
 #include "String.h"
+#include "CopyEngine.h"
+#include "DirCache.h"
+#include "DirEnumerator.h"
+#include "DirTree.h"
+#include "DriveMount.h"
+#include "MoveJournal.h"
+#include "StatCache.h"
+#include "TreeWalker.h"
+#include "Wildcard.h"
+#include "OutputSink.h"
 #include <xtl.h>
 #include <string>
 #include <stdio.h>
 #include <vector>
 #include <algorithm>
+#include <deque>
 
 #ifndef FILE_ATTRIBUTE_DIRECTORY
 #define FILE_ATTRIBUTE_DIRECTORY 0x00000010
@@ -21,6 +32,9 @@
 #ifndef FILE_ATTRIBUTE_ARCHIVE
 #define FILE_ATTRIBUTE_ARCHIVE 0x20
 #endif
+#ifndef FILE_ATTRIBUTE_NORMAL
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#endif
 #ifndef INVALID_HANDLE_VALUE
 #define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
 #endif
@@ -36,6 +50,9 @@
 #ifndef ERROR_ACCESS_DENIED
 #define ERROR_ACCESS_DENIED 5
 #endif
+#ifndef ERROR_NOT_SAME_DEVICE
+#define ERROR_NOT_SAME_DEVICE 17
+#endif
 
 struct DirEntry
 {
@@ -60,6 +77,17 @@ std::string FileSystem::ToApiPath(const std::string& path)
     return path.substr(0, p) + ":\\" + path.substr(p + 1);
 }
 
+std::string FileSystem::FromApiPath(const std::string& apiPath)
+{
+    std::string internalPath = apiPath;
+    size_t colon = internalPath.find(':');
+    if (colon != std::string::npos)
+    {
+        internalPath.erase(colon, 1);
+    }
+    return internalPath;
+}
+
 static std::string FormatFileTime(const FILETIME& ft)
 {
     SYSTEMTIME st;
@@ -117,43 +145,190 @@ static bool PassesAttributeFilter(const DirEntry& e, const std::string& attrib)
     return true;
 }
 
-static std::string GetExtension(const std::string& name)
+/** Sort record for one DirEntry: keys are computed once so comparisons never allocate. */
+struct DirSortKey
 {
-    size_t dot = name.rfind('.');
-    if (dot == std::string::npos)
-        return "";
-    return name.substr(dot);
+    size_t index;           /* position in the unsorted entry list */
+    const char* name;
+    size_t nameLength;
+    size_t upperOffset;     /* upper-cased name in the key arena (same length as name) */
+    size_t extOffset;       /* offset of the last '.' in name, or nameLength if there is none */
+    __int64 writeTime;
+    unsigned __int64 size;
+};
+
+/** Same ordering as std::string::compare (bytes compared as unsigned, shorter prefix first). */
+static int CompareBytes(const char* a, size_t aLength, const char* b, size_t bLength)
+{
+    int cmp = memcmp(a, b, (aLength < bLength) ? aLength : bLength);
+    if (cmp != 0)
+        return cmp;
+    return (aLength < bLength) ? -1 : (aLength > bLength) ? 1 : 0;
 }
 
-static int CompareDirEntry(const DirEntry& a, const DirEntry& b, char sortBy, bool reverse)
+/** Orders keys for /O:N (case-insensitive name), /O:E (extension, then name), /O:D (write time) and /O:S (size). */
+struct DirSortLess
 {
-    int cmp = 0;
-    if (sortBy == 'N' || sortBy == 0)
+    const char* arena;
+    char sortBy;
+    bool reverse;
+
+    int Compare(const DirSortKey& a, const DirSortKey& b) const
     {
-        std::string na = a.name, nb = b.name;
-        for (size_t i = 0; i < na.length(); i++) na[i] = (char)toupper((unsigned char)na[i]);
-        for (size_t i = 0; i < nb.length(); i++) nb[i] = (char)toupper((unsigned char)nb[i]);
-        cmp = na.compare(nb);
+        int cmp = 0;
+        if (sortBy == 'N' || sortBy == 0)
+        {
+            cmp = CompareBytes(arena + a.upperOffset, a.nameLength, arena + b.upperOffset, b.nameLength);
+        }
+        else if (sortBy == 'E')
+        {
+            cmp = CompareBytes(a.name + a.extOffset, a.nameLength - a.extOffset, b.name + b.extOffset, b.nameLength - b.extOffset);
+            if (cmp == 0)
+                cmp = CompareBytes(a.name, a.nameLength, b.name, b.nameLength);
+        }
+        else if (sortBy == 'D')
+        {
+            cmp = (a.writeTime < b.writeTime) ? -1 : (a.writeTime > b.writeTime) ? 1 : 0;
+        }
+        else if (sortBy == 'S')
+        {
+            cmp = (a.size < b.size) ? -1 : (a.size > b.size) ? 1 : 0;
+        }
+        return reverse ? -cmp : cmp;
     }
-    else if (sortBy == 'E')
+
+    bool operator()(const DirSortKey& a, const DirSortKey& b) const
     {
-        cmp = GetExtension(a.name).compare(GetExtension(b.name));
-        if (cmp == 0)
-            cmp = a.name.compare(b.name);
+        return Compare(a, b) < 0;
     }
-    else if (sortBy == 'D')
+};
+
+/** Stable O(n log n) sort of entries; equal keys keep their enumeration order. */
+static void SortDirEntries(std::vector<DirEntry>& entries, char sortBy, bool reverse)
+{
+    size_t count = entries.size();
+    if (count < 2)
+        return;
+
+    size_t arenaSize = 0;
+    for (size_t i = 0; i < count; i++)
+        arenaSize += entries[i].name.length();
+    std::string arena;
+    arena.reserve(arenaSize);
+    std::vector<DirSortKey> keys(count);
+    for (size_t i = 0; i < count; i++)
     {
-        __int64 ta = ((__int64)a.lastWriteTime.dwHighDateTime << 32) | a.lastWriteTime.dwLowDateTime;
-        __int64 tb = ((__int64)b.lastWriteTime.dwHighDateTime << 32) | b.lastWriteTime.dwLowDateTime;
-        cmp = (ta < tb) ? -1 : (ta > tb) ? 1 : 0;
+        const std::string& name = entries[i].name;
+        DirSortKey& k = keys[i];
+        k.index = i;
+        k.name = name.c_str();
+        k.nameLength = name.length();
+        k.upperOffset = arena.length();
+        for (size_t c = 0; c < name.length(); c++)
+            arena += (char)toupper((unsigned char)name[c]);
+        size_t dot = name.rfind('.');
+        k.extOffset = (dot == std::string::npos) ? name.length() : dot;
+        k.writeTime = ((__int64)entries[i].lastWriteTime.dwHighDateTime << 32) | entries[i].lastWriteTime.dwLowDateTime;
+        k.size = entries[i].size;
     }
-    else if (sortBy == 'S')
+
+    DirSortLess less;
+    less.arena = arena.data();
+    less.sortBy = sortBy;
+    less.reverse = reverse;
+    std::stable_sort(keys.begin(), keys.end(), less);
+
+    /* Names are swapped into place rather than copied; keys[] pointers are not used after this */
+    std::vector<DirEntry> sorted(count);
+    for (size_t i = 0; i < count; i++)
     {
-        cmp = (a.size < b.size) ? -1 : (a.size > b.size) ? 1 : 0;
+        DirEntry& from = entries[keys[i].index];
+        DirEntry& to = sorted[i];
+        to.name.swap(from.name);
+        to.isDir = from.isDir;
+        to.size = from.size;
+        to.lastWriteTime = from.lastWriteTime;
+        to.attributes = from.attributes;
     }
-    if (reverse)
-        cmp = -cmp;
-    return cmp;
+    entries.swap(sorted);
+}
+
+/** Running totals and wide-format column while DIR writes its entries. */
+struct DirListState
+{
+    int dirCount;
+    int fileCount;
+    unsigned __int64 totalBytes;
+    int entryLineCount;
+    int col;
+    DirListState() : dirCount(0), fileCount(0), totalBytes(0), entryLineCount(0), col(0) {}
+};
+
+static void WriteDirHeader(const std::string& path, const std::string& apiPath, OutputSink& output)
+{
+    std::string drivePart = path.find('\\') != std::string::npos ? path.substr(0, path.find('\\')) : path;
+    output.Write(" Volume in drive " + drivePart + " has no label.\n"
+                 " Volume Serial Number is 0000-0000\n\n"
+                 " Directory of " + apiPath + "\n\n");
+}
+
+/** Write text, highlighted when it names a directory. */
+static void WriteDirName(const std::string& text, bool isDir, OutputSink& output)
+{
+    if (isDir)
+        output.SetHighlight(true);
+    output.Write(text);
+    if (isDir)
+        output.SetHighlight(false);
+}
+
+static void WriteDirEntry(const DirEntry& e, const DirOptions& options, DirListState& state, OutputSink& output)
+{
+    const int WIDE_COLUMNS = 5;
+    const int WIDE_COL_WIDTH = 14;
+    if (e.isDir)
+    {
+        state.dirCount++;
+    }
+    else
+    {
+        state.fileCount++;
+        state.totalBytes += e.size;
+    }
+    std::string out;
+    if (options.wide)
+    {
+        std::string name = e.name;
+        if ((int)name.length() > WIDE_COL_WIDTH)
+            name = name.substr(0, WIDE_COL_WIDTH);
+        while ((int)name.length() < WIDE_COL_WIDTH)
+            name += " ";
+        WriteDirName(name, e.isDir, output);
+        state.col++;
+        if (state.col < WIDE_COLUMNS)
+            return;
+        out = "\n";
+        state.col = 0;
+    }
+    else if (e.isDir)
+    {
+        WriteDirName(FormatFileTime(e.lastWriteTime) + "    <DIR>          " + e.name, true, output);
+        out = "\n";
+    }
+    else
+    {
+        std::string sizeStr = String::FormatBytesWithCommas((uint64_t)e.size);
+        while (sizeStr.length() < 16)
+        {
+            sizeStr = " " + sizeStr;
+        }
+        sizeStr += " ";
+        out = FormatFileTime(e.lastWriteTime) + " " + sizeStr + e.name + "\n";
+    }
+    state.entryLineCount++;
+    if (options.pageLines > 0 && state.entryLineCount % options.pageLines == 0)
+        out += "--- More ---\n";
+    output.Write(out);
 }
 
 std::string FileSystem::ListDirectory(const std::string& path)
@@ -163,127 +338,94 @@ std::string FileSystem::ListDirectory(const std::string& path)
 
 std::string FileSystem::ListDirectory(const std::string& path, const DirOptions& options)
 {
-    std::string apiPath = ToApiPath(path);
-    std::string searchPath = apiPath;
-    if (searchPath.length() > 0 && searchPath[searchPath.length() - 1] != '\\')
-        searchPath += "\\";
-    searchPath += "*";
+    StringSink sink;
+    std::string err = ListDirectory(path, options, sink);
+    return sink.GetText() + err;
+}
 
-    WIN32_FIND_DATAA fd;
-    HANDLE h = FindFirstFileA(searchPath.c_str(), &fd);
-    if (h == INVALID_HANDLE_VALUE)
+std::string FileSystem::ListDirectory(const std::string& path, const DirOptions& options, OutputSink& output)
+{
+    /* "HDD0-E\Games\*.xbe\" lists HDD0-E\Games and keeps only the names the last segment matches */
+    std::string listPath = path;
+    Wildcard filter;
+    std::string trimmed = path;
+    while (trimmed.length() > 0 && (trimmed[trimmed.length() - 1] == '\\' || trimmed[trimmed.length() - 1] == '/'))
     {
-        DWORD err = GetLastError();
-        if (err == ERROR_PATH_NOT_FOUND || err == ERROR_FILE_NOT_FOUND)
+        trimmed.erase(trimmed.length() - 1, 1);
+    }
+    size_t slash = trimmed.find_last_of("\\/");
+    if (slash != std::string::npos && Wildcard::HasWildcards(trimmed.substr(slash + 1)))
+    {
+        filter.Compile(trimmed.substr(slash + 1));
+        listPath = trimmed.substr(0, slash + 1);
+    }
+    std::string apiPath = ToApiPath(listPath);
+
+    DirEnumerator dir;
+    if (!dir.Open(apiPath))
+    {
+        if (dir.WasNotFound())
             return "File Not Found\n";
         return "Error reading directory\n";
     }
 
+    /* Without /O entries are written in directory order as they are read; only a sort has to hold the listing */
+    bool sorted = (options.sortBy == 'N' || options.sortBy == 'D' || options.sortBy == 'S' || options.sortBy == 'E');
     std::vector<DirEntry> entries;
-    do
+    DirListState state;
+    bool headerWritten = false;
+    size_t listed = 0;
+    DirEnumEntry de;
+    while (dir.Next(de))
     {
+        if (!filter.Matches(de.name, de.nameLength))
+            continue;
+        listed++;
         DirEntry e;
-        e.name = fd.cFileName;
-        e.isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
-        e.size = ((unsigned __int64)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
-        e.lastWriteTime = fd.ftLastWriteTime;
-        e.attributes = fd.dwFileAttributes;
+        e.name.assign(de.name, de.nameLength);
+        e.isDir = de.isDir;
+        e.size = de.size;
+        e.lastWriteTime = de.lastWriteTime;
+        e.attributes = de.attributes;
         if (!PassesAttributeFilter(e, options.attrib))
             continue;
-        entries.push_back(e);
-    }
-    while (FindNextFileA(h, &fd));
-    FindClose(h);
-
-    if (options.sortBy == 'N' || options.sortBy == 'D' || options.sortBy == 'S' || options.sortBy == 'E')
-    {
-        for (size_t i = 0; i < entries.size(); i++)
+        if (sorted)
         {
-            for (size_t j = i + 1; j < entries.size(); j++)
-            {
-                if (CompareDirEntry(entries[i], entries[j], options.sortBy, options.sortReverse) > 0)
-                {
-                    DirEntry t = entries[i];
-                    entries[i] = entries[j];
-                    entries[j] = t;
-                }
-            }
+            entries.push_back(e);
+            continue;
+        }
+        if (!headerWritten)
+        {
+            WriteDirHeader(path, apiPath, output);
+            headerWritten = true;
         }
+        WriteDirEntry(e, options, state, output);
     }
+    dir.Close();
+    if (listed == 0)
+        return "File Not Found\n";
 
-    std::string out;
-    std::string drivePart = path.find('\\') != std::string::npos ? path.substr(0, path.find('\\')) : path;
-    out += " Volume in drive " + drivePart + " has no label.\n";
-    out += " Volume Serial Number is 0000-0000\n\n";
-    out += " Directory of " + apiPath + "\n\n";
-
-    int dirCount = 0;
-    int fileCount = 0;
-    unsigned __int64 totalBytes = 0;
-    int entryLineCount = 0;
-    const int WIDE_COLUMNS = 5;
-    const int WIDE_COL_WIDTH = 14;
-
-    if (options.wide)
+    if (sorted)
     {
-        int col = 0;
+        SortDirEntries(entries, options.sortBy, options.sortReverse);
+        WriteDirHeader(path, apiPath, output);
         for (size_t i = 0; i < entries.size(); i++)
         {
-            const DirEntry& e = entries[i];
-            if (e.isDir)
-                dirCount++;
-            else
-            {
-                fileCount++;
-                totalBytes += e.size;
-            }
-            std::string disp = e.name;
-            if ((int)disp.length() > WIDE_COL_WIDTH)
-                disp = disp.substr(0, WIDE_COL_WIDTH);
-            while ((int)disp.length() < WIDE_COL_WIDTH)
-                disp += " ";
-            out += disp;
-            col++;
-            if (col >= WIDE_COLUMNS)
-            {
-                out += "\n";
-                col = 0;
-                entryLineCount++;
-                if (options.pageLines > 0 && entryLineCount % options.pageLines == 0)
-                    out += "--- More ---\n";
-            }
+            WriteDirEntry(entries[i], options, state, output);
         }
-        if (col != 0)
-            out += "\n";
     }
-    else
+    else if (!headerWritten)
     {
-        for (size_t i = 0; i < entries.size(); i++)
-        {
-            const DirEntry& e = entries[i];
-            if (e.isDir)
-            {
-                dirCount++;
-                out += FormatFileTime(e.lastWriteTime) + "    <DIR>          " + e.name + "\n";
-            }
-            else
-            {
-                fileCount++;
-                totalBytes += e.size;
-                std::string sizeStr = String::FormatBytesWithCommas((uint64_t)e.size);
-                while (sizeStr.length() < 16)
-                {
-                    sizeStr = " " + sizeStr;
-                }
-                sizeStr += " ";
-                out += FormatFileTime(e.lastWriteTime) + " " + sizeStr + e.name + "\n";
-            }
-            entryLineCount++;
-            if (options.pageLines > 0 && entryLineCount % options.pageLines == 0)
-                out += "--- More ---\n";
-        }
+        WriteDirHeader(path, apiPath, output);
     }
 
+    std::string out;
+    if (options.wide && state.col != 0)
+        out += "\n";
+    int dirCount = state.dirCount;
+    int fileCount = state.fileCount;
+    unsigned __int64 totalBytes = state.totalBytes;
+
     ULARGE_INTEGER freeBytes, totalDisk, freeToCaller;
     freeBytes.QuadPart = 0;
     totalDisk.QuadPart = 0;
@@ -301,64 +443,19 @@ std::string FileSystem::ListDirectory(const std::string& path, const DirOptions&
         out += String::FormatBytesWithCommas((uint64_t)totalBytes) + " bytes\n";
         out += String::Format("               %d Dir(s)\n", dirCount);
     }
-    return out;
+    output.Write(out);
+    return "";
 }
 
 bool FileSystem::GetPathCompletions(const std::string& dirPath, const std::string& prefix, std::vector<std::string>& outNames, std::vector<bool>& outIsDir)
 {
-    outNames.clear();
-    outIsDir.clear();
-    std::string apiPath = ToApiPath(dirPath);
-    std::string searchPath = apiPath;
-    if (searchPath.length() > 0 && searchPath[searchPath.length() - 1] != '\\')
-    {
-        searchPath += "\\";
-    }
-    searchPath += "*";
-    WIN32_FIND_DATAA fd;
-    HANDLE h = FindFirstFileA(searchPath.c_str(), &fd);
-    if (h == INVALID_HANDLE_VALUE)
-    {
-        return false;
-    }
-    do
-    {
-        std::string name = fd.cFileName;
-        if (name == "." || name == "..")
-        {
-            continue;
-        }
-        bool isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
-        if (prefix.length() > name.length())
-        {
-            continue;
-        }
-        bool match = true;
-        for (size_t i = 0; i < prefix.length(); i++)
-        {
-            char a = (char)toupper((unsigned char)name[i]);
-            char b = (char)toupper((unsigned char)prefix[i]);
-            if (a != b)
-            {
-                match = false;
-                break;
-            }
-        }
-        if (match)
-        {
-            outNames.push_back(name);
-            outIsDir.push_back(isDir);
-        }
-    }
-    while (FindNextFileA(h, &fd));
-    FindClose(h);
-    return true;
+    return DirCache::GetCompletions(dirPath, prefix, outNames, outIsDir);
 }
 
 bool FileSystem::IsDirectory(const std::string& path)
 {
     std::string apiPath = ToApiPath(path);
-    DWORD attrs = GetFileAttributesA(apiPath.c_str());
+    DWORD attrs = StatCache::GetAttributes(apiPath);
     if (attrs == 0xFFFFFFFF)
     {
         return false;
@@ -369,12 +466,13 @@ bool FileSystem::IsDirectory(const std::string& path)
 bool FileSystem::Exists(const std::string& path)
 {
     std::string apiPath = ToApiPath(path);
-    DWORD attrs = GetFileAttributesA(apiPath.c_str());
+    DWORD attrs = StatCache::GetAttributes(apiPath);
     return (attrs != 0xFFFFFFFF);
 }
 
 std::string FileSystem::CreateDir(const std::string& path)
 {
+    DirCache::Clear();
     if (path.empty())
     {
         return "The syntax of the command is incorrect.\n";
@@ -419,6 +517,7 @@ std::string FileSystem::CreateDir(const std::string& path)
     {
         built += "\\";
         built += segments[i];
+        StatCache::Invalidate(built);
         if (!CreateDirectoryA(built.c_str(), NULL))
         {
             DWORD err = GetLastError();
@@ -435,85 +534,9 @@ std::string FileSystem::CreateDir(const std::string& path)
     return "";
 }
 
-static std::string RemoveDirRecursive(const std::string& apiPath)
-{
-    std::string searchPath = apiPath;
-    if (searchPath.length() > 0 && searchPath[searchPath.length() - 1] != '\\')
-    {
-        searchPath += "\\";
-    }
-    searchPath += "*";
-    WIN32_FIND_DATAA fd;
-    HANDLE h = FindFirstFileA(searchPath.c_str(), &fd);
-    if (h != INVALID_HANDLE_VALUE)
-    {
-        do
-        {
-            std::string name = fd.cFileName;
-            if (name == "." || name == "..")
-            {
-                continue;
-            }
-            std::string full = apiPath;
-            if (full.length() > 0 && full[full.length() - 1] != '\\')
-            {
-                full += "\\";
-            }
-            full += name;
-            if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
-            {
-                std::string err = RemoveDirRecursive(full);
-                if (!err.empty())
-                {
-                    FindClose(h);
-                    return err;
-                }
-                if (!RemoveDirectoryA(full.c_str()))
-                {
-                    DWORD e = GetLastError();
-                    FindClose(h);
-                    if (e == ERROR_PATH_NOT_FOUND)
-                    {
-                        return "The system cannot find the path specified.\n";
-                    }
-                    return "Unable to remove directory.\n";
-                }
-            }
-            else
-            {
-                if (!DeleteFileA(full.c_str()))
-                {
-                    DWORD e = GetLastError();
-                    FindClose(h);
-                    if (e == ERROR_PATH_NOT_FOUND)
-                    {
-                        return "The system cannot find the path specified.\n";
-                    }
-                    return "Unable to delete file.\n";
-                }
-            }
-        }
-        while (FindNextFileA(h, &fd));
-        FindClose(h);
-    }
-    if (!RemoveDirectoryA(apiPath.c_str()))
-    {
-        DWORD err = GetLastError();
-        if (err == ERROR_DIR_NOT_EMPTY)
-        {
-            return "The directory is not empty.\n";
-        }
-        if (err == ERROR_PATH_NOT_FOUND)
-        {
-            return "The system cannot find the path specified.\n";
-        }
-        return "Unable to remove directory.\n";
-    }
-    return "";
-}
-
-std::string FileSystem::RemoveDir(const std::string& path, bool removeTree)
+std::string FileSystem::RemoveDir(const std::string& path, bool removeTree, OutputSink* progress)
 {
+    DirCache::Clear();
     if (path.empty())
     {
         return "The syntax of the command is incorrect.\n";
@@ -527,7 +550,7 @@ std::string FileSystem::RemoveDir(const std::string& path, bool removeTree)
     {
         return "The syntax of the command is incorrect.\n";
     }
-    DWORD attrs = GetFileAttributesA(apiPath.c_str());
+    DWORD attrs = StatCache::GetAttributes(apiPath);
     if (attrs == 0xFFFFFFFF)
     {
         return "The system cannot find the file specified.\n";
@@ -538,22 +561,9 @@ std::string FileSystem::RemoveDir(const std::string& path, bool removeTree)
     }
     if (removeTree)
     {
-        return RemoveDirRecursive(apiPath);
-    }
-    if (!RemoveDirectoryA(apiPath.c_str()))
-    {
-        DWORD err = GetLastError();
-        if (err == ERROR_DIR_NOT_EMPTY)
-        {
-            return "The directory is not empty.\n";
-        }
-        if (err == ERROR_PATH_NOT_FOUND)
-        {
-            return "The system cannot find the path specified.\n";
-        }
-        return "Unable to remove directory.\n";
+        return DirTree::Remove(apiPath, true, progress);
     }
-    return "";
+    return DirTree::RemoveEmptyDir(apiPath);
 }
 
 static std::string GetParentPath(const std::string& path)
@@ -570,15 +580,16 @@ static std::string GetParentPath(const std::string& path)
     return path.substr(0, p);
 }
 
-std::string FileSystem::CopyPath(const std::string& src, const std::string& dst, bool overwrite)
+std::string FileSystem::CopyPath(const std::string& src, const std::string& dst, bool overwrite, OutputSink* progress, bool verify)
 {
+    DirCache::Clear();
     if (src.empty() || dst.empty())
     {
         return "The syntax of the command is incorrect.\n";
     }
     std::string srcApi = ToApiPath(src);
     std::string dstApi = ToApiPath(dst);
-    DWORD srcAttr = GetFileAttributesA(srcApi.c_str());
+    DWORD srcAttr = StatCache::GetAttributes(srcApi);
     if (srcAttr == 0xFFFFFFFF)
     {
         return "The system cannot find the file specified.\n";
@@ -596,7 +607,7 @@ std::string FileSystem::CopyPath(const std::string& src, const std::string& dst,
         {
             dstParentInternal.erase(colon, 1);
         }
-        if (GetFileAttributesA(dstParent.c_str()) == 0xFFFFFFFF)
+        if (StatCache::GetAttributes(dstParent) == 0xFFFFFFFF)
         {
             std::string err = CreateDir(dstParentInternal);
             if (!err.empty())
@@ -605,88 +616,375 @@ std::string FileSystem::CopyPath(const std::string& src, const std::string& dst,
             }
         }
     }
-    if (!CopyFileA(srcApi.c_str(), dstApi.c_str(), overwrite ? FALSE : TRUE))
+    if (!verify)
     {
-        DWORD err = GetLastError();
-        if (err == ERROR_FILE_EXISTS)
+        return CopyEngine::Copy(srcApi, dstApi, overwrite ? COPY_OVERWRITE : COPY_CREATE_NEW, progress);
+    }
+    CopyChecksums checksums;
+    std::string err = CopyEngine::Copy(srcApi, dstApi, overwrite ? COPY_OVERWRITE : COPY_CREATE_NEW, progress, &checksums);
+    if (!err.empty())
+    {
+        return err;
+    }
+    return CopyEngine::Verify(dstApi, checksums, progress);
+}
+
+std::string FileSystem::AppendFiles(const std::vector<std::string>& sources, const std::string& dest, OutputSink* progress, bool verify)
+{
+    DirCache::Clear();
+    if (sources.empty())
+    {
+        return "The syntax of the command is incorrect.\n";
+    }
+    std::string err = CopyPath(sources[0], dest, true, progress, verify);
+    if (!err.empty())
+    {
+        return err;
+    }
+    std::string destApi = ToApiPath(dest);
+    for (size_t i = 1; i < sources.size(); i++)
+    {
+        CopyChecksums checksums;
+        err = CopyEngine::Copy(ToApiPath(sources[i]), destApi, COPY_APPEND, progress, verify ? &checksums : NULL);
+        if (err.empty() && verify)
         {
-            return "File exists.\n";
+            err = CopyEngine::Verify(destApi, checksums, progress);
         }
-        if (err == ERROR_PATH_NOT_FOUND)
+        if (!err.empty())
         {
-            return "The system cannot find the path specified.\n";
+            return err;
         }
-        return "Unable to copy file.\n";
     }
     return "";
 }
 
-std::string FileSystem::AppendFiles(const std::vector<std::string>& sources, const std::string& dest)
+#define TREE_COPY_MAX_PENDING 256
+
+static std::string JoinApiPath(const std::string& dir, const std::string& name)
 {
-    if (sources.empty())
+    if (name.empty())
+    {
+        return dir;
+    }
+    if (!dir.empty() && dir[dir.length() - 1] != '\\')
+    {
+        return dir + "\\" + name;
+    }
+    return dir + name;
+}
+
+/** Clear READONLY on an existing destination so a copy can replace it; CopyEngine gives each copy the source attributes, which may include it. */
+static void ClearReadOnly(const std::string& apiPath)
+{
+    DWORD attrs = StatCache::GetAttributes(apiPath);
+    if (attrs != 0xFFFFFFFF && (attrs & FILE_ATTRIBUTE_READONLY) != 0)
+    {
+        SetFileAttributesA(apiPath.c_str(), attrs & ~FILE_ATTRIBUTE_READONLY);
+        StatCache::Invalidate(apiPath);
+    }
+}
+
+/** Remove a copy that failed verification, whatever attributes it was given. */
+static void DeleteBadCopy(const std::string& apiPath)
+{
+    SetFileAttributesA(apiPath.c_str(), FILE_ATTRIBUTE_NORMAL);
+    DeleteFileA(apiPath.c_str());
+    StatCache::Invalidate(apiPath);
+}
+
+/** Create apiPath, creating missing parents first; an existing directory counts as success. */
+static bool EnsureApiDirectory(const std::string& apiPath)
+{
+    StatCache::Invalidate(apiPath);
+    if (CreateDirectoryA(apiPath.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        return true;
+    }
+    if (GetLastError() != ERROR_PATH_NOT_FOUND)
+    {
+        return false;
+    }
+    size_t slash = apiPath.find_last_of('\\');
+    if (slash == std::string::npos || slash == 0 || apiPath[slash - 1] == ':')
+    {
+        return false;
+    }
+    return EnsureApiDirectory(apiPath.substr(0, slash)) && CreateDirectoryA(apiPath.c_str(), NULL) != FALSE;
+}
+
+std::string FileSystem::CopyTree(const std::string& src, const std::string& dst, const TreeCopyOptions& options, OutputSink& output)
+{
+    DirCache::Clear();
+    if (src.empty() || dst.empty())
     {
         return "The syntax of the command is incorrect.\n";
     }
-    std::string err = CopyPath(sources[0], dest, true);
-    if (!err.empty())
+    std::string srcApi = ToApiPath(src);
+    std::string dstApi = ToApiPath(dst);
+    DWORD srcAttr = StatCache::GetAttributes(srcApi);
+    if (srcAttr == 0xFFFFFFFF)
     {
-        return err;
+        return "File not found - " + src + "\n";
     }
-    std::string destApi = ToApiPath(dest);
-    HANDLE hDest = CreateFileA(destApi.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hDest == INVALID_HANDLE_VALUE)
+    if ((srcAttr & FILE_ATTRIBUTE_DIRECTORY) == 0)
     {
-        return "Unable to open destination for append.\n";
+        return "The directory name is invalid.\n";
     }
-    if (SetFilePointer(hDest, 0, NULL, FILE_END) == (DWORD)-1)
+    std::string srcPrefix = String::ToUpper(JoinApiPath(srcApi, "x"));
+    std::string dstPrefix = String::ToUpper(JoinApiPath(dstApi, "x"));
+    srcPrefix.erase(srcPrefix.length() - 1, 1);
+    dstPrefix.erase(dstPrefix.length() - 1, 1);
+    if (dstPrefix.compare(0, srcPrefix.length(), srcPrefix) == 0)
     {
-        CloseHandle(hDest);
-        return "Unable to seek destination.\n";
+        return "Cannot perform a cyclic copy\n";
     }
-    for (size_t i = 1; i < sources.size(); i++)
+    if (!EnsureApiDirectory(dstApi))
+    {
+        return "Unable to create directory.\n";
+    }
+
+    TreeWalker walker;
+    if (!walker.Start(srcApi, options.subdirs || options.emptyDirs))
+    {
+        return "Unable to copy directory.\n";
+    }
+    CopyEngine::BeginBatch();
+    DWORD startTick = GetTickCount();
+    unsigned int fileCount = 0;
+    unsigned __int64 byteCount = 0;
+    CopyMode mode = options.overwrite ? COPY_OVERWRITE : COPY_CREATE_NEW;
+    std::string result;
+    std::deque<TreeBatch*> pending;
+    while (result.empty())
     {
-        std::string srcApi = ToApiPath(sources[i]);
-        HANDLE hSrc = CreateFileA(srcApi.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-        if (hSrc == INVALID_HANDLE_VALUE)
+        /* Metadata runs ahead of data: every directory the walker has already listed is taken (and with /E created) before the next directory's files are copied */
+        if (pending.empty())
         {
-            CloseHandle(hDest);
-            return "The system cannot find the file specified.\n";
+            TreeBatch* first = walker.Next();
+            if (first == NULL)
+            {
+                break;
+            }
+            pending.push_back(first);
+            if (options.emptyDirs && !EnsureApiDirectory(JoinApiPath(dstApi, first->relativeDir)))
+            {
+                result = "Unable to create directory - " + FromApiPath(JoinApiPath(dstApi, first->relativeDir)) + "\n";
+                break;
+            }
+        }
+        TreeBatch* listed = NULL;
+        while (pending.size() < TREE_COPY_MAX_PENDING && (listed = walker.TryNext()) != NULL)
+        {
+            pending.push_back(listed);
+            if (options.emptyDirs && !EnsureApiDirectory(JoinApiPath(dstApi, listed->relativeDir)))
+            {
+                result = "Unable to create directory - " + FromApiPath(JoinApiPath(dstApi, listed->relativeDir)) + "\n";
+                break;
+            }
+        }
+        if (!result.empty())
+        {
+            break;
+        }
+
+        TreeBatch* batch = pending.front();
+        pending.pop_front();
+        std::string srcDir = JoinApiPath(srcApi, batch->relativeDir);
+        std::string dstDir = JoinApiPath(dstApi, batch->relativeDir);
+        if (!batch->files.empty() && !options.emptyDirs && !EnsureApiDirectory(dstDir))
+        {
+            result = "Unable to create directory - " + FromApiPath(dstDir) + "\n";
         }
-        char buf[8192];
-        DWORD done = 0;
-        while (ReadFile(hSrc, buf, sizeof(buf), &done, NULL) && done > 0)
+        for (size_t i = 0; i < batch->files.size() && result.empty(); i++)
         {
-            DWORD written = 0;
-            if (!WriteFile(hDest, buf, done, &written, NULL) || written != done)
+            const TreeFile& file = batch->files[i];
+            std::string srcFile = JoinApiPath(srcDir, file.name);
+            if (!options.quiet)
             {
-                CloseHandle(hSrc);
-                CloseHandle(hDest);
-                return "Unable to write destination.\n";
+                output.Write(FromApiPath(srcFile) + "\n");
+            }
+            std::string dstFile = JoinApiPath(dstDir, file.name);
+            if (options.replaceReadOnly && options.overwrite)
+            {
+                ClearReadOnly(dstFile);
+            }
+            CopyChecksums checksums;
+            /* The walker already listed the attributes; pass them so Copy does not stat every file */
+            result = CopyEngine::Copy(srcFile, dstFile, mode, &output, options.verify ? &checksums : NULL, file.attributes);
+            if (result.empty() && options.verify)
+            {
+                result = CopyEngine::Verify(dstFile, checksums, &output);
+                if (!result.empty() && options.removeSource)
+                {
+                    /* The source stays, so a half-moved tree keeps no corrupt copy */
+                    DeleteBadCopy(dstFile);
+                }
+            }
+            if (result.empty() && options.removeSource)
+            {
+                if ((file.attributes & FILE_ATTRIBUTE_READONLY) != 0)
+                {
+                    SetFileAttributesA(srcFile.c_str(), file.attributes & ~FILE_ATTRIBUTE_READONLY);
+                }
+                if (!DeleteFileA(srcFile.c_str()))
+                {
+                    result = "Unable to delete file - " + FromApiPath(srcFile) + "\n";
+                }
+            }
+            if (result.empty())
+            {
+                fileCount++;
+                byteCount += file.size;
             }
         }
-        CloseHandle(hSrc);
+        delete batch;
     }
-    CloseHandle(hDest);
-    return "";
+    while (!pending.empty())
+    {
+        delete pending.front();
+        pending.pop_front();
+    }
+    walker.Stop();
+    CopyEngine::EndBatch();
+    if (options.removeSource)
+    {
+        StatCache::Invalidate(srcApi);
+    }
+
+    DWORD elapsed = GetTickCount() - startTick;
+    if (elapsed == 0)
+    {
+        elapsed = 1;
+    }
+    output.Write(String::Format("%u File(s) %s\n", fileCount, options.removeSource ? "moved" : "copied"));
+    if (fileCount > 0)
+    {
+        double seconds = (double)elapsed / 1000.0;
+        double megabytes = (double)(__int64)byteCount / (1024.0 * 1024.0);
+        output.Write(String::Format("%s bytes in %.2f s (%.1f files/s, %.1f MB/s)\n",
+            String::FormatBytesWithCommas(byteCount).c_str(), seconds, (double)fileCount / seconds, megabytes / seconds));
+    }
+    unsigned int failedDirs = walker.GetFailedDirCount();
+    if (failedDirs > 0)
+    {
+        output.Write(String::Format("%u director%s could not be read.\n", failedDirs, (failedDirs == 1) ? "y" : "ies"));
+    }
+    return result;
+}
+
+static std::string GetApiDrive(const std::string& apiPath)
+{
+    size_t colon = apiPath.find(':');
+    return (colon == std::string::npos) ? "" : String::ToUpper(apiPath.substr(0, colon));
+}
+
+/** Move srcApi to another volume: copy, verify, then delete the source, under a MoveJournal entry. The source goes last, so after an interruption the same steps can simply be run again while it exists; resuming sets replaceReadOnly, since the copies already made carry the source attributes. */
+static std::string MoveAcrossVolumes(const std::string& srcApi, const std::string& dstApi, bool overwrite, bool replaceReadOnly, OutputSink* progress)
+{
+    DWORD srcAttr = StatCache::GetAttributes(srcApi);
+    if (srcAttr == 0xFFFFFFFF)
+    {
+        return "The system cannot find the file specified.\n";
+    }
+    if (!MoveJournal::Begin(srcApi, dstApi))
+    {
+        return "Unable to write the move journal.\n";
+    }
+    std::string result;
+    if ((srcAttr & FILE_ATTRIBUTE_DIRECTORY) != 0)
+    {
+        TreeCopyOptions options;
+        options.subdirs = true;
+        options.emptyDirs = true;
+        options.overwrite = overwrite;
+        options.quiet = true;
+        options.verify = true;
+        options.removeSource = true;
+        options.replaceReadOnly = replaceReadOnly;
+        StringSink discard;
+        OutputSink* treeOutput = (progress != NULL) ? progress : &discard;
+        result = FileSystem::CopyTree(FileSystem::FromApiPath(srcApi), FileSystem::FromApiPath(dstApi), options, *treeOutput);
+        if (result.empty())
+        {
+            /* Every file has been moved; only the emptied directories remain */
+            result = DirTree::Remove(srcApi, false, progress);
+        }
+    }
+    else
+    {
+        if (replaceReadOnly && overwrite)
+        {
+            ClearReadOnly(dstApi);
+        }
+        CopyChecksums checksums;
+        result = CopyEngine::Copy(srcApi, dstApi, overwrite ? COPY_OVERWRITE : COPY_CREATE_NEW, progress, &checksums);
+        if (result.empty())
+        {
+            result = CopyEngine::Verify(dstApi, checksums, progress);
+            if (!result.empty())
+            {
+                DeleteBadCopy(dstApi);
+            }
+        }
+        if (result.empty())
+        {
+            if ((srcAttr & FILE_ATTRIBUTE_READONLY) != 0)
+            {
+                SetFileAttributesA(srcApi.c_str(), srcAttr & ~FILE_ATTRIBUTE_READONLY);
+            }
+            if (!DeleteFileA(srcApi.c_str()))
+            {
+                result = "The file was copied but the source could not be deleted.\n";
+            }
+        }
+    }
+    MoveJournal::End();
+    StatCache::Invalidate(srcApi);
+    StatCache::Invalidate(dstApi);
+    return result;
+}
+
+void FileSystem::ResumeInterruptedMove(OutputSink& output)
+{
+    std::string srcApi;
+    std::string dstApi;
+    if (!MoveJournal::GetPending(srcApi, dstApi))
+    {
+        MoveJournal::End();
+        return;
+    }
+    DriveMount::Mount(GetApiDrive(srcApi));
+    DriveMount::Mount(GetApiDrive(dstApi));
+    if (StatCache::GetAttributes(srcApi) == 0xFFFFFFFF)
+    {
+        /* The source is only deleted after its copy verified, so that move had finished */
+        MoveJournal::End();
+        return;
+    }
+    output.Write("Resuming interrupted move of " + FileSystem::FromApiPath(srcApi) + " to " + FileSystem::FromApiPath(dstApi) + "\n");
+    std::string err = MoveAcrossVolumes(srcApi, dstApi, true, true, &output);
+    output.Write(err.empty() ? std::string("Move completed.\n") : err);
 }
 
-std::string FileSystem::MovePath(const std::string& src, const std::string& dst, bool overwrite)
+std::string FileSystem::MovePath(const std::string& src, const std::string& dst, bool overwrite, OutputSink* progress)
 {
+    DirCache::Clear();
     if (src.empty() || dst.empty())
     {
         return "The syntax of the command is incorrect.\n";
     }
     std::string srcApi = ToApiPath(src);
     std::string dstApi = ToApiPath(dst);
-    DWORD srcAttr = GetFileAttributesA(srcApi.c_str());
+    DWORD srcAttr = StatCache::GetAttributes(srcApi);
     if (srcAttr == 0xFFFFFFFF)
     {
         return "The system cannot find the file specified.\n";
     }
     bool srcIsDir = (srcAttr & FILE_ATTRIBUTE_DIRECTORY) != 0;
-    DWORD dstAttr = GetFileAttributesA(dstApi.c_str());
+    DWORD dstAttr = StatCache::GetAttributes(dstApi);
     bool dstExists = (dstAttr != 0xFFFFFFFF);
     bool dstIsDir = dstExists && ((dstAttr & FILE_ATTRIBUTE_DIRECTORY) != 0);
+    bool crossVolume = GetApiDrive(srcApi) != GetApiDrive(dstApi);
 
     if (dstExists)
     {
@@ -707,7 +1005,8 @@ std::string FileSystem::MovePath(const std::string& src, const std::string& dst,
         {
             return "File exists.\n";
         }
-        if (!DeleteFileA(dstApi.c_str()))
+        /* Across volumes the copy replaces the destination, which stays intact until then */
+        if (!crossVolume && !DeleteFileA(dstApi.c_str()))
         {
             DWORD err = GetLastError();
             if (err == ERROR_ACCESS_DENIED)
@@ -718,9 +1017,18 @@ std::string FileSystem::MovePath(const std::string& src, const std::string& dst,
         }
     }
 
+    StatCache::Invalidate(dstApi);
+    if (crossVolume)
+    {
+        return MoveAcrossVolumes(srcApi, dstApi, overwrite, false, progress);
+    }
     if (!MoveFileA(srcApi.c_str(), dstApi.c_str()))
     {
         DWORD err = GetLastError();
+        if (err == ERROR_NOT_SAME_DEVICE)
+        {
+            return MoveAcrossVolumes(srcApi, dstApi, overwrite, false, progress);
+        }
         if (err == ERROR_ALREADY_EXISTS || err == ERROR_FILE_EXISTS)
         {
             return "File exists.\n";
@@ -735,92 +1043,43 @@ std::string FileSystem::MovePath(const std::string& src, const std::string& dst,
         }
         return "Unable to move file.\n";
     }
+    StatCache::Invalidate(srcApi);
     return "";
 }
 
-static bool WildcardMatch(const char* pattern, const char* name)
-{
-    while (*pattern && *name)
-    {
-        if (*pattern == '*')
-        {
-            pattern++;
-            if (!*pattern)
-                return true;
-            while (*name)
-            {
-                if (WildcardMatch(pattern, name))
-                    return true;
-                name++;
-            }
-            return false;
-        }
-        if (*pattern == '?' || (char)toupper((unsigned char)*pattern) == (char)toupper((unsigned char)*name))
-        {
-            pattern++;
-            name++;
-            continue;
-        }
-        return false;
-    }
-    while (*pattern == '*')
-        pattern++;
-    return (!*pattern && !*name);
-}
-
 static bool PathHasWildcards(const std::string& path)
 {
     size_t slash = path.find_last_of("\\/");
-    std::string last = (slash != std::string::npos) ? path.substr(slash + 1) : path;
-    return (last.find('*') != std::string::npos || last.find('?') != std::string::npos);
+    return Wildcard::HasWildcards((slash != std::string::npos) ? path.substr(slash + 1) : path);
 }
 
-static void CollectFilesInDir(const std::string& apiDir, const std::string& pattern, bool recursive, const std::string& attribFilter, std::vector<std::string>& outPaths)
+/** FindFiles: collects the API paths of the matching files of each directory. */
+struct CollectWalk : public DirTreeVisitor
 {
-    std::string searchPath = apiDir;
-    if (searchPath.length() > 0 && searchPath[searchPath.length() - 1] != '\\')
-        searchPath += "\\";
-    searchPath += "*";
-    WIN32_FIND_DATAA fd;
-    HANDLE h = FindFirstFileA(searchPath.c_str(), &fd);
-    if (h == INVALID_HANDLE_VALUE)
-        return;
-    do
+    virtual bool OnFile(const std::string& path, const DirEnumEntry& entry)
     {
-        std::string name = fd.cFileName;
-        if (name == "." || name == "..")
-            continue;
-        std::string full = apiDir;
-        if (full.length() > 0 && full[full.length() - 1] != '\\')
-            full += "\\";
-        full += name;
-        if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
-        {
-            if (recursive)
-                CollectFilesInDir(full, pattern, true, attribFilter, outPaths);
-        }
-        else
-        {
-            if (!pattern.empty() && !WildcardMatch(pattern.c_str(), name.c_str()))
-                continue;
-            DirEntry e;
-            e.name = name;
-            e.isDir = false;
-            e.attributes = fd.dwFileAttributes;
-            if (!PassesAttributeFilter(e, attribFilter))
-                continue;
-            outPaths.push_back(full);
-        }
+        if (!pattern->Matches(entry.name, entry.nameLength))
+            return true;
+        /* COPY and CRC stat each path they are handed; the listing already has the answer */
+        StatCache::Remember(path, entry.attributes & ~FILE_ATTRIBUTE_DIRECTORY);
+        outPaths->push_back(path);
+        return true;
     }
-    while (FindNextFileA(h, &fd));
-    FindClose(h);
+
+    const Wildcard* pattern;
+    std::vector<std::string>* outPaths;
+};
+
+static void CollectFilesInDir(const std::string& apiDir, const Wildcard& pattern, bool recursive, std::vector<std::string>& outPaths)
+{
+    CollectWalk walk;
+    walk.pattern = &pattern;
+    walk.outPaths = &outPaths;
+    DirTree::Walk(apiDir, recursive, walk);
 }
 
-static std::string DeleteOneFile(const std::string& apiPath, bool force)
+static std::string DeleteOneFile(const std::string& apiPath, DWORD attrs, bool force)
 {
-    DWORD attrs = GetFileAttributesA(apiPath.c_str());
-    if (attrs == 0xFFFFFFFF)
-        return "The system cannot find the file specified.\n";
     if ((attrs & FILE_ATTRIBUTE_DIRECTORY) != 0)
         return ""; /* skip directories */
     if ((attrs & FILE_ATTRIBUTE_READONLY) != 0)
@@ -830,6 +1089,7 @@ static std::string DeleteOneFile(const std::string& apiPath, bool force)
         if (!SetFileAttributesA(apiPath.c_str(), attrs & ~FILE_ATTRIBUTE_READONLY))
             return "Access is denied.\n";
     }
+    StatCache::Invalidate(apiPath);
     if (!DeleteFileA(apiPath.c_str()))
     {
         DWORD err = GetLastError();
@@ -840,8 +1100,56 @@ static std::string DeleteOneFile(const std::string& apiPath, bool force)
     return "";
 }
 
-std::string FileSystem::DeletePath(const std::string& path, bool recursive, bool force, const std::string& attribFilter, bool showOnlyDeleted)
+/** State shared by one DeletePath walk; deletes the matching files of each directory while it is listed. */
+struct DeleteWalk : public DirTreeVisitor
+{
+    virtual bool OnFile(const std::string& path, const DirEnumEntry& entry);
+
+    const Wildcard* pattern;
+    bool force;
+    const std::string* attribFilter;
+    bool showOnlyDeleted;
+    bool continueOnError;
+    OutputSink* output;
+    std::string firstError;
+    unsigned long failed;
+};
+
+/** Delete one file and report it; returns false when the walk should stop. */
+static bool DeleteAndReport(const std::string& apiPath, DWORD attrs, DeleteWalk& walk)
+{
+    std::string err = DeleteOneFile(apiPath, attrs, walk.force);
+    std::string internalPath = FileSystem::FromApiPath(apiPath);
+    if (!err.empty())
+    {
+        walk.failed++;
+        if (walk.firstError.empty())
+            walk.firstError = err;
+        if (!walk.continueOnError)
+            return false;
+        walk.output->Write("Could not delete " + internalPath + " - " + err);
+        return true;
+    }
+    if (walk.showOnlyDeleted)
+        walk.output->Write(internalPath + "\n");
+    return true;
+}
+
+bool DeleteWalk::OnFile(const std::string& path, const DirEnumEntry& entry)
 {
+    if (!pattern->Matches(entry.name, entry.nameLength))
+        return true;
+    DirEntry e;
+    e.isDir = false;
+    e.attributes = entry.attributes;
+    if (!PassesAttributeFilter(e, *attribFilter))
+        return true;
+    return DeleteAndReport(path, entry.attributes, *this);
+}
+
+std::string FileSystem::DeletePath(const std::string& path, bool recursive, bool force, const std::string& attribFilter, bool showOnlyDeleted, bool continueOnError, OutputSink& output)
+{
+    DirCache::Clear();
     if (path.empty())
         return "The syntax of the command is incorrect.\n";
     std::string apiPath = ToApiPath(path);
@@ -850,7 +1158,15 @@ std::string FileSystem::DeletePath(const std::string& path, bool recursive, bool
     if (apiPath.empty())
         return "The syntax of the command is incorrect.\n";
 
-    std::vector<std::string> toDelete;
+    DeleteWalk walk;
+    walk.pattern = NULL;
+    walk.force = force;
+    walk.attribFilter = &attribFilter;
+    walk.showOnlyDeleted = showOnlyDeleted;
+    walk.continueOnError = continueOnError;
+    walk.output = &output;
+    walk.failed = 0;
+
     if (PathHasWildcards(path))
     {
         std::string dirPart = GetParentPath(apiPath);
@@ -861,50 +1177,65 @@ std::string FileSystem::DeletePath(const std::string& path, bool recursive, bool
             dirPart = apiPath;
             patternPart = "*";
         }
-        CollectFilesInDir(dirPart, patternPart, recursive, attribFilter, toDelete);
+        Wildcard pattern(patternPart);
+        walk.pattern = &pattern;
+        DirTree::Walk(dirPart, recursive, walk);
     }
     else
     {
-        DWORD attrs = GetFileAttributesA(apiPath.c_str());
+        DWORD attrs = StatCache::GetAttributes(apiPath);
         if (attrs == 0xFFFFFFFF)
             return "Could Not Find " + path + "\n";
         if ((attrs & FILE_ATTRIBUTE_DIRECTORY) != 0)
         {
-            CollectFilesInDir(apiPath, "", recursive, attribFilter, toDelete);
+            Wildcard pattern;
+            walk.pattern = &pattern;
+            DirTree::Walk(apiPath, recursive, walk);
         }
         else
         {
             DirEntry e;
-            e.name = path;
-            size_t p = e.name.find_last_of("\\/");
-            if (p != std::string::npos)
-                e.name = e.name.substr(p + 1);
             e.attributes = attrs;
             e.isDir = false;
             if (PassesAttributeFilter(e, attribFilter))
-                toDelete.push_back(apiPath);
+                DeleteAndReport(apiPath, attrs, walk);
         }
     }
 
-    std::string result;
-    for (size_t i = 0; i < toDelete.size(); i++)
+    if (walk.failed == 0)
+        return "";
+    if (continueOnError)
+        return String::Format("%lu file(s) could not be deleted.\n", walk.failed);
+    return showOnlyDeleted ? "" : walk.firstError;
+}
+
+std::string FileSystem::FindFiles(const std::string& path, bool recursive, std::vector<std::string>& outPaths)
+{
+    outPaths.clear();
+    std::string apiPath = ToApiPath(path);
+    while (apiPath.length() > 0 && (apiPath[apiPath.length() - 1] == '\\' || apiPath[apiPath.length() - 1] == '/'))
+        apiPath.erase(apiPath.length() - 1, 1);
+    if (apiPath.empty())
+        return "The syntax of the command is incorrect.\n";
+
+    if (PathHasWildcards(path))
     {
-        std::string err = DeleteOneFile(toDelete[i], force);
-        if (!err.empty())
-        {
-            if (result.empty() && !showOnlyDeleted)
-                result = err;
-            break;
-            /* stop on first error */
-        }
-        if (showOnlyDeleted)
-        {
-            std::string internalPath = toDelete[i];
-            size_t colon = internalPath.find(':');
-            if (colon != std::string::npos)
-                internalPath = internalPath.substr(0, colon) + internalPath.substr(colon + 1);
-            result += internalPath + "\n";
-        }
+        std::string dirPart = GetParentPath(apiPath);
+        size_t slash = path.find_last_of("\\/");
+        std::string patternPart = (slash != std::string::npos) ? path.substr(slash + 1) : path;
+        CollectFilesInDir(dirPart.empty() ? apiPath : dirPart, Wildcard(dirPart.empty() ? "*" : patternPart), recursive, outPaths);
     }
-    return result;
+    else
+    {
+        DWORD attrs = StatCache::GetAttributes(apiPath);
+        if (attrs == 0xFFFFFFFF)
+            return "File Not Found - " + path + "\n";
+        if ((attrs & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            CollectFilesInDir(apiPath, Wildcard(), recursive, outPaths);
+        else
+            outPaths.push_back(apiPath);
+    }
+    if (outPaths.empty())
+        return "File Not Found - " + path + "\n";
+    return "";
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "External.h"
+#include "OutputSink.h"
 
 #include <string>
 #include <vector>
@@ -9,10 +10,22 @@ struct DirOptions
 {
     bool wide;           /* /W: wide list format */
     std::string attrib; /* /A[:]attributes: D R H A S, prefix - to exclude */
-    char sortBy;         /* /O[:]sort: N=name, D=date, S=size, E=extension */
+    char sortBy;         /* /O[:]sort: N=name, D=date, S=size, E=extension; 0 = directory order, streamed */
     bool sortReverse;   /* - prefix on sort (e.g. -N) */
     int pageLines;      /* /P: insert "More" every N lines (0 = off) */
-    DirOptions() : wide(false), sortBy('N'), sortReverse(false), pageLines(0) {}
+    DirOptions() : wide(false), sortBy(0), sortReverse(false), pageLines(0) {}
+};
+
+struct TreeCopyOptions
+{
+    bool subdirs;       /* /S: copy subdirectories that contain files */
+    bool emptyDirs;     /* /E: copy all subdirectories, including empty ones */
+    bool overwrite;     /* /Y (default); /-Y fails on an existing file */
+    bool quiet;         /* /Q: do not list each file as it is copied */
+    bool verify;        /* re-read each copied file and compare chunk CRCs */
+    bool removeSource;  /* delete each source file once it is copied (MOVE) */
+    bool replaceReadOnly; /* clear READONLY on a destination file before overwriting it (resumed MOVE) */
+    TreeCopyOptions() : subdirs(false), emptyDirs(false), overwrite(true), quiet(false), verify(false), removeSource(false), replaceReadOnly(false) {}
 };
 
 class FileSystem
@@ -21,12 +34,18 @@ public:
     /** Convert internal path (e.g. HDD0-E\\) to Win32 path (e.g. HDD0-E:\\) */
     static std::string ToApiPath(const std::string& path);
 
+    /** Convert Win32 path (e.g. HDD0-E:\\x) back to the internal path shown to the user (e.g. HDD0-E\\x) */
+    static std::string FromApiPath(const std::string& apiPath);
+
     /** List directory in DIR-style format; returns formatted string or error message */
     static std::string ListDirectory(const std::string& path);
 
     /** List directory with DIR options (/W, /A, /O, /P) */
     static std::string ListDirectory(const std::string& path, const DirOptions& options);
 
+    /** List directory with DIR options, writing each line to output as it is formatted; returns an error message or empty */
+    static std::string ListDirectory(const std::string& path, const DirOptions& options, OutputSink& output);
+
     /** Return true if path exists and is a directory */
     static bool IsDirectory(const std::string& path);
 
@@ -36,20 +55,29 @@ public:
     /** Create directory and any intermediate directories; returns empty on success, error message otherwise */
     static std::string CreateDir(const std::string& path);
 
-    /** Remove directory; if removeTree true, delete contents recursively (/S). Returns empty on success, error message otherwise */
-    static std::string RemoveDir(const std::string& path, bool removeTree);
+    /** Remove directory; if removeTree true, delete contents too (/S), walking the tree with an explicit stack. Removals that run longer than half a second write a "\r" dirs/s and files/s line to progress if it is not NULL. Returns empty on success, error message otherwise */
+    static std::string RemoveDir(const std::string& path, bool removeTree, OutputSink* progress = NULL);
+
+    /** Copy single file through CopyEngine; creates parent of destination if needed. overwrite: false = fail if dest exists. Long copies report progress to progress if given. verify (/V): re-read the destination and compare chunk CRCs taken during the copy. Returns empty or error message */
+    static std::string CopyPath(const std::string& src, const std::string& dst, bool overwrite, OutputSink* progress = NULL, bool verify = false);
+
+    /** Append sources to destination (first source overwrites dest, rest appended), verifying each part if verify. Returns empty or error message */
+    static std::string AppendFiles(const std::vector<std::string>& sources, const std::string& dest, OutputSink* progress = NULL, bool verify = false);
+
+    /** Copy the files of directory src into dst (created if missing), with subdirectories per options. Directories are listed on a worker thread while files are copied; ends with a files/s and MB/s summary. Returns empty or error message */
+    static std::string CopyTree(const std::string& src, const std::string& dst, const TreeCopyOptions& options, OutputSink& output);
 
-    /** Copy single file; creates parent of destination if needed. overwrite: false = fail if dest exists. Returns empty or error message */
-    static std::string CopyPath(const std::string& src, const std::string& dst, bool overwrite);
+    /** Delete one or more files while the directories are walked. recursive=/S, force=/F, attribFilter=/A, showOnlyDeleted=true when /S (show only deleted), continueOnError=/C (report each failure to output and keep going). Returns empty or error message (with /C, the count of files that could not be deleted); with /S writes "path\n" to output per deleted file. */
+    static std::string DeletePath(const std::string& path, bool recursive, bool force, const std::string& attribFilter, bool showOnlyDeleted, bool continueOnError, OutputSink& output);
 
-    /** Append sources to destination (first source overwrites dest, rest appended). Returns empty or error message */
-    static std::string AppendFiles(const std::vector<std::string>& sources, const std::string& dest);
+    /** Fill outPaths with the API paths of the files path names: a file, every file in a directory, or the files matching a wildcard in the last segment; recursive=/S. Returns empty or error message */
+    static std::string FindFiles(const std::string& path, bool recursive, std::vector<std::string>& outPaths);
 
-    /** Delete one or more files. recursive=/S, force=/F, attribFilter=/A, showOnlyDeleted=true when /S (show only deleted). Returns empty or error message; with /S appends "path\n" per deleted file. */
-    static std::string DeletePath(const std::string& path, bool recursive, bool force, const std::string& attribFilter, bool showOnlyDeleted);
+    /** Move or rename file or directory. overwrite: allow overwriting existing destination file. Moves to another volume copy, verify and then delete the source under MoveJournal, reporting progress to progress if given. Returns empty or error message. */
+    static std::string MovePath(const std::string& src, const std::string& dst, bool overwrite, OutputSink* progress = NULL);
 
-    /** Move or rename file or directory. overwrite: allow overwriting existing destination file. Returns empty or error message. */
-    static std::string MovePath(const std::string& src, const std::string& dst, bool overwrite);
+    /** Finish a cross-volume move that an earlier session left in the journal, reporting to output. Call once at startup. */
+    static void ResumeInterruptedMove(OutputSink& output);
 
     /** Fill outNames/outIsDir with directory entries whose names start with prefix (case-insensitive). dirPath is internal path (e.g. HDD0-E\\cerbios). Returns true if directory was listed. */
     static bool GetPathCompletions(const std::string& dirPath, const std::string& prefix, std::vector<std::string>& outNames, std::vector<bool>& outIsDir);
@@ -0,0 +1,101 @@
+#include "FrameScheduler.h"
+#include "Drawing.h"
+#include "Debug.h"
+#include "TerminalBuffer.h"
+
+#define CURSOR_BLINK_MS 530
+/** Longest idle wait between input polls (keeps typing latency at about one frame) */
+#define FRAME_IDLE_POLL_MS 16
+/** Interval between frame counter reports on the debug output */
+#define FRAME_STATS_INTERVAL_MS 60000
+
+namespace
+{
+    bool s_forcePresent = true;
+    bool s_lastCursorOn = false;
+    int s_lastCursorX = -1;
+    int s_lastCursorY = -1;
+    uint32_t s_lastTextColor = 0;
+    uint32_t s_lastBackgroundColor = 0;
+    uint32_t s_framesRendered = 0;
+    uint32_t s_framesSkipped = 0;
+    DWORD s_lastStatsTick = 0;
+}
+
+static bool IsCursorOn(DWORD tick)
+{
+    return (tick % (CURSOR_BLINK_MS * 2)) < CURSOR_BLINK_MS;
+}
+
+static void ReportStats(DWORD tick)
+{
+    if (tick - s_lastStatsTick < FRAME_STATS_INTERVAL_MS)
+    {
+        return;
+    }
+    s_lastStatsTick = tick;
+    Debug::Print("Frames: %u rendered, %u skipped\n", (unsigned int)s_framesRendered, (unsigned int)s_framesSkipped);
+}
+
+void FrameScheduler::NotifyInput()
+{
+    s_forcePresent = true;
+}
+
+void FrameScheduler::Invalidate()
+{
+    s_forcePresent = true;
+    TerminalBuffer::MarkAllRowsDirty();
+}
+
+bool FrameScheduler::PresentIfNeeded()
+{
+    DWORD tick = GetTickCount();
+    bool changed = s_forcePresent ||
+        TerminalBuffer::HasDirtyRows() ||
+        IsCursorOn(tick) != s_lastCursorOn ||
+        TerminalBuffer::GetInputCursorX() != s_lastCursorX ||
+        TerminalBuffer::GetInputCursorY() != s_lastCursorY ||
+        TerminalBuffer::GetTextColor() != s_lastTextColor ||
+        TerminalBuffer::GetBackgroundColor() != s_lastBackgroundColor;
+    ReportStats(tick);
+    if (!changed)
+    {
+        s_framesSkipped++;
+        return false;
+    }
+    Present();
+    return true;
+}
+
+void FrameScheduler::Present()
+{
+    DWORD tick = GetTickCount();
+    s_lastCursorOn = IsCursorOn(tick);
+    s_lastCursorX = TerminalBuffer::GetInputCursorX();
+    s_lastCursorY = TerminalBuffer::GetInputCursorY();
+    s_lastTextColor = TerminalBuffer::GetTextColor();
+    s_lastBackgroundColor = TerminalBuffer::GetBackgroundColor();
+    s_forcePresent = false;
+    const char* buffer = TerminalBuffer::GetBuffer();
+    Drawing::DrawTerminal(buffer, TerminalBuffer::GetAttributes(), TerminalBuffer::GetDirtyRows(), s_lastTextColor, s_lastCursorX, s_lastCursorY, s_lastCursorOn);
+    TerminalBuffer::ClearDirtyRows();
+    s_framesRendered++;
+}
+
+void FrameScheduler::WaitForWork()
+{
+    DWORD tick = GetTickCount();
+    DWORD untilBlink = CURSOR_BLINK_MS - (tick % CURSOR_BLINK_MS);
+    Sleep(untilBlink < FRAME_IDLE_POLL_MS ? untilBlink : FRAME_IDLE_POLL_MS);
+}
+
+uint32_t FrameScheduler::GetFramesRendered()
+{
+    return s_framesRendered;
+}
+
+uint32_t FrameScheduler::GetFramesSkipped()
+{
+    return s_framesSkipped;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "External.h"
+
+/** Decides when the main loop presents the terminal: only when something visible changed. */
+class FrameScheduler
+{
+public:
+    /** Input arrived this iteration; the next PresentIfNeeded renders a frame. */
+    static void NotifyInput();
+    /** Force the next PresentIfNeeded to render (e.g. after another screen used the display). */
+    static void Invalidate();
+    /** Render when the buffer is dirty, input arrived, the cursor moved or the blink phase changed. Returns true if a frame was presented. */
+    static bool PresentIfNeeded();
+    /** Render and present the terminal unconditionally. */
+    static void Present();
+    /** Idle wait after a skipped frame, bounded by the input poll interval and the next blink phase change. */
+    static void WaitForWork();
+    static uint32_t GetFramesRendered();
+    static uint32_t GetFramesSkipped();
+};
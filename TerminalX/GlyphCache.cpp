@@ -0,0 +1,453 @@
+#include "GlyphCache.h"
+#include "Resources.h"
+#include "Swizzler.h"
+#include "Debug.h"
+
+#define SSFN_IMPLEMENTATION
+#define SFFN_MAXLINES 8192
+#define SSFN_memcmp memcmp
+#define SSFN_memset memset
+#define SSFN_realloc realloc
+#define SSFN_free free
+#include "ssfn.h"
+
+#define GLYPH_CACHE_WIDTH 512
+#define GLYPH_CACHE_HEIGHT 512
+/* Lazily rasterized glyphs live in fixed slots below the baked atlas (1 texel of padding inside each slot) */
+#define GLYPH_SLOT_WIDTH 24
+#define GLYPH_SLOT_HEIGHT 40
+#define GLYPH_MAX_SLOTS ((GLYPH_CACHE_WIDTH / GLYPH_SLOT_WIDTH) * (GLYPH_CACHE_HEIGHT / GLYPH_SLOT_HEIGHT))
+/* Render target for one glyph before it is copied into its slot */
+#define GLYPH_SCRATCH_DIMENSION 64
+#define GLYPH_PAGE_SIZE 256
+#define GLYPH_PAGE_COUNT 256
+
+#define GLYPH_UNKNOWN 0
+#define GLYPH_READY 1
+#define GLYPH_MISSING 2
+
+namespace
+{
+    struct GlyphEntry
+    {
+        GlyphRect rect;
+        short slot;           /* -1 for baked glyphs, which are never evicted */
+        unsigned char state;
+    };
+
+    struct GlyphSlot
+    {
+        uint32_t unicode;
+        uint32_t lastUsed;    /* frame number of the last lookup */
+        bool used;
+    };
+
+    /* Two-level page table over the BMP: s_pages[unicode >> 8][unicode & 0xFF], pages allocated on first touch */
+    GlyphEntry* s_pages[GLYPH_PAGE_COUNT];
+
+    GlyphSlot s_slots[GLYPH_MAX_SLOTS];
+    int s_slotCount = 0;
+    int s_slotTop = 0;
+    uint32_t s_frame = 1;
+    uint32_t s_evictions = 0;
+
+    D3DTexture* s_texture = NULL;
+    uint8_t* s_lockedBits = NULL;
+
+    ssfn_t* s_font = NULL;
+    bool s_fontFailed = false;
+    int s_cellWidth = 0;  /* advance used for glyph rects outside the baked set, so line art joins up */
+    uint32_t s_scratch[GLYPH_SCRATCH_DIMENSION * GLYPH_SCRATCH_DIMENSION];
+
+    /* CP437 0x80-0xFF */
+    static const unsigned short s_cp437High[128] =
+    {
+        0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7, 0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+        0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9, 0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+        0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA, 0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+        0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+        0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+        0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+        0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4, 0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+        0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0
+    };
+}
+
+static GlyphEntry* GetEntry(uint32_t unicode)
+{
+    GlyphEntry*& page = s_pages[unicode >> 8];
+    if (page == NULL)
+    {
+        page = (GlyphEntry*)malloc(GLYPH_PAGE_SIZE * sizeof(GlyphEntry));
+        if (page == NULL)
+        {
+            return NULL;
+        }
+        memset(page, 0, GLYPH_PAGE_SIZE * sizeof(GlyphEntry));
+    }
+    return &page[unicode & 0xFF];
+}
+
+static int EncodeUtf8(uint32_t unicode, char* out)
+{
+    if (unicode < 0x80)
+    {
+        out[0] = (char)unicode;
+        out[1] = 0;
+        return 1;
+    }
+    if (unicode < 0x800)
+    {
+        out[0] = (char)(0xC0 | (unicode >> 6));
+        out[1] = (char)(0x80 | (unicode & 0x3F));
+        out[2] = 0;
+        return 2;
+    }
+    out[0] = (char)(0xE0 | (unicode >> 12));
+    out[1] = (char)(0x80 | ((unicode >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (unicode & 0x3F));
+    out[3] = 0;
+    return 3;
+}
+
+static bool LoadFont()
+{
+    if (s_font != NULL)
+    {
+        return true;
+    }
+    if (s_fontFailed)
+    {
+        return false;
+    }
+    s_font = (ssfn_t*)malloc(sizeof(ssfn_t));
+    if (s_font == NULL)
+    {
+        s_fontFailed = true;
+        return false;
+    }
+    memset(s_font, 0, sizeof(ssfn_t));
+    if (ssfn_load(s_font, &terminal_sfn[0]) != 0)
+    {
+        free(s_font);
+        s_font = NULL;
+        s_fontFailed = true;
+        return false;
+    }
+    ssfn_select(s_font, SSFN_FAMILY_ANY, "CascadiaCode", SSFN_STYLE_REGULAR, 32);
+
+    /* A full-width horizontal line gives the cell advance; fall back to 'M' */
+    int width;
+    int height;
+    int left;
+    int top;
+    if (ssfn_bbox(s_font, "\xE2\x94\x80", &width, &height, &left, &top) != 0 &&
+        ssfn_bbox(s_font, "M", &width, &height, &left, &top) != 0)
+    {
+        width = GLYPH_SLOT_WIDTH - 2;
+    }
+    s_cellWidth = (width < GLYPH_SLOT_WIDTH - 2) ? width : GLYPH_SLOT_WIDTH - 2;
+    return true;
+}
+
+/** Coverage for block elements the font lacks (-1 if unicode is not one of them). */
+static int SyntheticCoverage(uint32_t unicode, int x, int y, int width, int height)
+{
+    switch (unicode)
+    {
+        case 0x2580: return (y < height / 2) ? 255 : 0;
+        case 0x2584: return (y >= height / 2) ? 255 : 0;
+        case 0x2588: return 255;
+        case 0x258C: return (x < width / 2) ? 255 : 0;
+        case 0x2590: return (x >= width / 2) ? 255 : 0;
+        case 0x2591: return 64;
+        case 0x2592: return 128;
+        case 0x2593: return 192;
+        case 0x25A0: return (x >= width / 4 && x < width - width / 4 && y >= height / 3 && y < height - height / 3) ? 255 : 0;
+        default: return -1;
+    }
+}
+
+/** Rasterize unicode into slot and fill rect; returns false if there is no glyph for it. */
+static bool RasterizeGlyph(uint32_t unicode, int slot, GlyphRect& rect)
+{
+    int slotsPerRow = GLYPH_CACHE_WIDTH / GLYPH_SLOT_WIDTH;
+    int slotX = (slot % slotsPerRow) * GLYPH_SLOT_WIDTH;
+    int slotY = s_slotTop + (slot / slotsPerRow) * GLYPH_SLOT_HEIGHT;
+    int maxHeight = GLYPH_SLOT_HEIGHT - 2;
+
+    memset(s_scratch, 0, sizeof(s_scratch));
+    bool synthetic = false;
+    int height = maxHeight;
+    if (!LoadFont())
+    {
+        return false;
+    }
+    char text[5];
+    EncodeUtf8(unicode, text);
+    int width;
+    int left;
+    int top;
+    if (ssfn_bbox(s_font, text, &width, &height, &left, &top) == 0 && height > 0)
+    {
+        ssfn_buf_t buffer;
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.ptr = (uint8_t*)s_scratch;
+        buffer.x = left;
+        buffer.y = top;
+        buffer.w = GLYPH_SCRATCH_DIMENSION;
+        buffer.h = GLYPH_SCRATCH_DIMENSION;
+        buffer.p = GLYPH_SCRATCH_DIMENSION * 4;
+        buffer.bg = 0;
+        buffer.fg = 0xffffffff;
+        ssfn_render(s_font, &buffer, text);
+    }
+    else if (SyntheticCoverage(unicode, 0, 0, 1, 1) >= 0)
+    {
+        synthetic = true;
+        height = maxHeight;
+        int mHeight;
+        if (ssfn_bbox(s_font, "M", &width, &mHeight, &left, &top) == 0)
+        {
+            height = mHeight;
+        }
+    }
+    else
+    {
+        return false;
+    }
+    if (height > maxHeight)
+    {
+        height = maxHeight;
+    }
+    width = s_cellWidth;
+
+    /* Write the whole slot so nothing of the previous occupant remains */
+    for (int y = 0; y < GLYPH_SLOT_HEIGHT; y++)
+    {
+        for (int x = 0; x < GLYPH_SLOT_WIDTH; x++)
+        {
+            int gx = x - 1;
+            int gy = y - 1;
+            uint8_t alpha = 0;
+            if (gx >= 0 && gy >= 0 && gx < width && gy < height)
+            {
+                alpha = synthetic ? (uint8_t)SyntheticCoverage(unicode, gx, gy, width, height) :
+                    (uint8_t)(s_scratch[gy * GLYPH_SCRATCH_DIMENSION + gx] >> 24);
+            }
+            s_lockedBits[Swizzler::TexelOffset(slotX + x, slotY + y, GLYPH_CACHE_WIDTH, GLYPH_CACHE_HEIGHT)] = alpha;
+        }
+    }
+    rect.x = (unsigned short)(slotX + 1);
+    rect.y = (unsigned short)(slotY + 1);
+    rect.width = (unsigned short)width;
+    rect.height = (unsigned short)height;
+    return true;
+}
+
+/** Free slot, or the least recently used one not needed this frame (-1 if every slot is in use this frame). */
+static int AcquireSlot()
+{
+    int oldest = -1;
+    for (int i = 0; i < s_slotCount; i++)
+    {
+        if (!s_slots[i].used)
+        {
+            return i;
+        }
+        if (s_slots[i].lastUsed != s_frame && (oldest < 0 || s_slots[i].lastUsed < s_slots[oldest].lastUsed))
+        {
+            oldest = i;
+        }
+    }
+    if (oldest >= 0)
+    {
+        GlyphEntry* evicted = GetEntry(s_slots[oldest].unicode);
+        if (evicted != NULL)
+        {
+            evicted->state = GLYPH_UNKNOWN;
+        }
+        s_slots[oldest].used = false;
+        s_evictions++;
+    }
+    return oldest;
+}
+
+static bool LockTexture()
+{
+    if (s_lockedBits != NULL)
+    {
+        return true;
+    }
+    D3DLOCKED_RECT lockedRect;
+    if (s_texture == NULL || FAILED(s_texture->LockRect(0, &lockedRect, NULL, 0)))
+    {
+        return false;
+    }
+    s_lockedBits = (uint8_t*)lockedRect.pBits;
+    return true;
+}
+
+/** Copy the baked atlas into the top-left corner of the locked cache texture; returns its height (0 if not used). */
+static int LoadBakedAtlas()
+{
+    if (TERMINAL_ATLAS_WIDTH > GLYPH_CACHE_WIDTH || TERMINAL_ATLAS_HEIGHT > GLYPH_CACHE_HEIGHT)
+    {
+        return 0;
+    }
+    if (TERMINAL_ATLAS_WIDTH == GLYPH_CACHE_WIDTH && TERMINAL_ATLAS_HEIGHT <= TERMINAL_ATLAS_WIDTH &&
+        TERMINAL_ATLAS_WIDTH <= 2 * TERMINAL_ATLAS_HEIGHT)
+    {
+        /* Same Morton addressing in both textures: the baked texels are a prefix of the cache */
+        memcpy(s_lockedBits, terminal_atlas, sizeof(terminal_atlas));
+    }
+    else
+    {
+        for (uint32_t y = 0; y < TERMINAL_ATLAS_HEIGHT; y++)
+        {
+            for (uint32_t x = 0; x < TERMINAL_ATLAS_WIDTH; x++)
+            {
+                s_lockedBits[Swizzler::TexelOffset(x, y, GLYPH_CACHE_WIDTH, GLYPH_CACHE_HEIGHT)] =
+                    terminal_atlas[Swizzler::TexelOffset(x, y, TERMINAL_ATLAS_WIDTH, TERMINAL_ATLAS_HEIGHT)];
+            }
+        }
+    }
+    for (int i = 0; i < TERMINAL_ATLAS_GLYPHS; i++)
+    {
+        const unsigned short* baked = terminal_atlas_rects[i];
+        GlyphEntry* entry = GetEntry(baked[0]);
+        if (entry == NULL)
+        {
+            continue;
+        }
+        entry->rect.x = baked[1];
+        entry->rect.y = baked[2];
+        entry->rect.width = baked[3];
+        entry->rect.height = baked[4];
+        entry->slot = -1;
+        entry->state = GLYPH_READY;
+    }
+    return TERMINAL_ATLAS_HEIGHT;
+}
+
+bool GlyphCache::Init(LPDIRECT3DDEVICE8 d3dDevice)
+{
+    if (s_texture != NULL)
+    {
+        return true;
+    }
+    if (FAILED(D3DXCreateTexture(d3dDevice, GLYPH_CACHE_WIDTH, GLYPH_CACHE_HEIGHT, 1, 0, D3DFMT_A8, D3DPOOL_DEFAULT, &s_texture)))
+    {
+        s_texture = NULL;
+        Debug::Print("Failed to create glyph cache texture\n");
+        return false;
+    }
+    if (!LockTexture())
+    {
+        return false;
+    }
+    D3DSURFACE_DESC surfaceDesc;
+    s_texture->GetLevelDesc(0, &surfaceDesc);
+    memset(s_lockedBits, 0, surfaceDesc.Size);
+
+    int bakedHeight = LoadBakedAtlas();
+    s_slotTop = bakedHeight;
+    s_slotCount = (GLYPH_CACHE_WIDTH / GLYPH_SLOT_WIDTH) * ((GLYPH_CACHE_HEIGHT - s_slotTop) / GLYPH_SLOT_HEIGHT);
+    memset(s_slots, 0, sizeof(s_slots));
+    EndFrame();
+    Debug::Print("Glyph cache %dx%d: %d baked glyphs, %d slots\n", GLYPH_CACHE_WIDTH, GLYPH_CACHE_HEIGHT, bakedHeight > 0 ? TERMINAL_ATLAS_GLYPHS : 0, s_slotCount);
+    return true;
+}
+
+D3DTexture* GlyphCache::GetTexture()
+{
+    return s_texture;
+}
+
+int GlyphCache::GetTextureWidth()
+{
+    return GLYPH_CACHE_WIDTH;
+}
+
+int GlyphCache::GetTextureHeight()
+{
+    return GLYPH_CACHE_HEIGHT;
+}
+
+void GlyphCache::BeginFrame()
+{
+    s_frame++;
+}
+
+void GlyphCache::EndFrame()
+{
+    if (s_lockedBits != NULL)
+    {
+        s_texture->UnlockRect(0);
+        s_lockedBits = NULL;
+    }
+}
+
+const GlyphRect* GlyphCache::Lookup(uint32_t unicode)
+{
+    if (unicode == 0 || unicode >= GLYPH_PAGE_COUNT * GLYPH_PAGE_SIZE || s_texture == NULL)
+    {
+        return NULL;
+    }
+    GlyphEntry* entry = GetEntry(unicode);
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+    if (entry->state == GLYPH_READY)
+    {
+        if (entry->slot >= 0)
+        {
+            s_slots[entry->slot].lastUsed = s_frame;
+        }
+        return &entry->rect;
+    }
+    if (entry->state == GLYPH_MISSING)
+    {
+        return NULL;
+    }
+
+    int slot = AcquireSlot();
+    if (slot < 0 || !LockTexture())
+    {
+        return NULL;
+    }
+    if (!RasterizeGlyph(unicode, slot, entry->rect))
+    {
+        entry->state = GLYPH_MISSING;
+        return NULL;
+    }
+    entry->slot = (short)slot;
+    entry->state = GLYPH_READY;
+    s_slots[slot].unicode = unicode;
+    s_slots[slot].lastUsed = s_frame;
+    s_slots[slot].used = true;
+    return &entry->rect;
+}
+
+uint32_t GlyphCache::UnicodeForByte(unsigned char c)
+{
+    if (c < 0x20)
+    {
+        return 0;
+    }
+    if (c < 0x7F)
+    {
+        return c;
+    }
+    if (c == 0x7F)
+    {
+        return 0x2302;
+    }
+    return s_cp437High[c - 0x80];
+}
+
+uint32_t GlyphCache::GetEvictionCount()
+{
+    return s_evictions;
+}
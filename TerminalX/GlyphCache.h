@@ -0,0 +1,33 @@
+#pragma once
+
+#include "External.h"
+
+/** Atlas placement of one glyph (texels in the glyph cache texture). */
+struct GlyphRect
+{
+    unsigned short x;
+    unsigned short y;
+    unsigned short width;
+    unsigned short height;
+};
+
+/** Font texture holding the baked ASCII atlas plus glyphs rasterized with SSFN on first use (LRU slots). */
+class GlyphCache
+{
+public:
+    /** Create the cache texture and load the baked atlas. Returns false if the texture cannot be created. */
+    static bool Init(LPDIRECT3DDEVICE8 d3dDevice);
+    static D3DTexture* GetTexture();
+    static int GetTextureWidth();
+    static int GetTextureHeight();
+    /** Start a frame: glyphs looked up during this frame are not evicted before EndFrame. */
+    static void BeginFrame();
+    /** Unlock the texture if glyphs were rasterized this frame. Call before drawing. */
+    static void EndFrame();
+    /** Rect for a Unicode code point, rasterizing it if needed; NULL if the font has no glyph or no slot is free this frame. */
+    static const GlyphRect* Lookup(uint32_t unicode);
+    /** Code point a terminal byte is drawn as (ASCII, CP437 for 0x80-0xFF, 0 for control bytes). */
+    static uint32_t UnicodeForByte(unsigned char c);
+    /** Incremented every time a cached glyph is evicted (cached geometry using old rects is stale). */
+    static uint32_t GetEvictionCount();
+};
@@ -1,4 +1,5 @@
 #include "InputManager.h"
+#include "DirCache.h"
 #include "Drawing.h"
 #include "Math.h"
 #include "String.h"
@@ -439,6 +440,7 @@ void InputManager::ProcessMemoryUnit()
 
                     MU_CloseDeviceObject(iPort, iSlot);
                     mMemoryUnityHandles[index] = 0;
+                    DirCache::Clear();
                 }
 
                 if ((mask & insertions) != 0 && mMemoryUnityHandles[index] == 0) {
@@ -632,6 +634,21 @@ void InputManager::PumpInput()
     ProcessMemoryUnit();
 }
 
+bool InputManager::CancelPressed()
+{
+    PumpInput();
+    KeyboardState keyboardState;
+    if (TryGetKeyboardState(-1, &keyboardState) && keyboardState.KeyDown && keyboardState.Buttons[KeyboardCtrl])
+    {
+        char key = keyboardState.VirtualKey;
+        if (key == 'C' || keyboardState.Ascii == 'c' || keyboardState.Ascii == 'C' || keyboardState.Ascii == 3)
+        {
+            return true;
+        }
+    }
+    return ControllerPressed(ControllerB, -1);
+}
+
 MousePosition InputManager::GetMousePosition()
 {
     return mMousePosition;
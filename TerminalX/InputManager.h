@@ -146,5 +146,7 @@ public:
     static bool HasMouse(int port);
     static bool IsMemoryUnitMounted(char letter);
     static void PumpInput();
+    /** Pump input and report Ctrl+C on a keyboard or B on a controller; for long-running commands to poll between blocks. */
+    static bool CancelPressed();
     static MousePosition GetMousePosition();
 };
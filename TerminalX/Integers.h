@@ -1,5 +1,6 @@
 #pragma once
 
+#ifdef _XBOX
 typedef signed char int8_t;
 typedef short int16_t;
 typedef long int32_t;
@@ -7,4 +8,8 @@ typedef long long int64_t;
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
 typedef unsigned long uint32_t;
-typedef unsigned long long uint64_t;
\ No newline at end of file
+typedef unsigned long long uint64_t;
+#else
+/* Host builds (HostTests) take the fixed-width types from the compiler, where long may be 64 bits */
+#include <stdint.h>
+#endif
@@ -15,7 +15,9 @@
 #include "CommandProcessor.h"
 #include "DriveMount.h"
 #include "FileSystem.h"
-#include "String.h"
+#include "FrameScheduler.h"
+#include "OutputSink.h"
+#include "PathResolver.h"
 #include "ssfn.h"
 
 #include <xgraphics.h>
@@ -74,58 +76,21 @@ static void WaitButton(ControllerButton controllerButton)
 #define VK_RIGHT 0x27  /* Right arrow */
 #define VK_DOWN  0x28  /* Down arrow */
 #define VK_TAB   0x09
-#define CURSOR_BLINK_MS 530
 #define COMMAND_HISTORY_MAX 50
 
 static std::vector<std::string> s_commandHistory;
 static size_t s_historyIndex = 0;  /* when == size, we're at "new" line */
 
-static void ResolvePathForCompletion(const std::string& pathArg, const std::string& currentDir, std::string& outPath)
-{
-    outPath = currentDir;
-    size_t colon = pathArg.find(':');
-    if (colon != std::string::npos)
-    {
-        std::string drivePart = String::ToUpper(pathArg.substr(0, colon));
-        std::string pathPart = pathArg.substr(colon + 1);
-        while (!pathPart.empty() && (pathPart[0] == '\\' || pathPart[0] == '/'))
-        {
-            pathPart.erase(0, 1);
-        }
-        if (!drivePart.empty())
-        {
-            DriveMount::Mount(drivePart.c_str());
-            outPath = drivePart + "\\";
-            if (!pathPart.empty() && pathPart != "." && pathPart != "..")
-            {
-                outPath += pathPart;
-            }
-        }
-    }
-    else if (!pathArg.empty() && pathArg != "." && pathArg != "..")
-    {
-        if (outPath.length() > 0 && outPath[outPath.length() - 1] != '\\')
-        {
-            outPath += "\\";
-        }
-        outPath += pathArg;
-    }
-    while (outPath.length() > 0 && (outPath[outPath.length() - 1] == '\\' || outPath[outPath.length() - 1] == '/'))
-    {
-        outPath.erase(outPath.length() - 1, 1);
-    }
-    if (outPath.empty() && currentDir.length() > 0)
-    {
-        outPath = currentDir;
-        while (outPath.length() > 0 && (outPath[outPath.length() - 1] == '\\' || outPath[outPath.length() - 1] == '/'))
-        {
-            outPath.erase(outPath.length() - 1, 1);
-        }
-    }
-}
+/* Tab cycling: when completion is ambiguous, each further Tab swaps in the next candidate */
+static std::vector<std::string> s_tabCandidates;
+static size_t s_tabIndex = 0;
+static int s_tabTokenStart = 0;
+static std::string s_tabLine;  /* input line right after the last cycled completion */
 
-static bool TryPathCompletion(const std::string& line, int cursorPos, int& tokenStart, int& tokenEnd, std::string& replacement)
+/** Complete the token before the cursor. If several names match and no longer common prefix exists, candidates receives every full completion and replacement is the first. */
+static bool TryPathCompletion(const std::string& line, int cursorPos, int& tokenStart, int& tokenEnd, std::string& replacement, std::vector<std::string>& candidates)
 {
+    candidates.clear();
     if (cursorPos < 0 || cursorPos > (int)line.length())
     {
         return false;
@@ -155,7 +120,7 @@ static bool TryPathCompletion(const std::string& line, int cursorPos, int& token
         prefix = token.substr(lastSlash + 1);
     }
     std::string listPath;
-    ResolvePathForCompletion(dirPart, CommandProcessor::GetCurrentDir(), listPath);
+    PathResolver::Resolve(dirPart, CommandProcessor::GetCurrentDir(), listPath);
     std::vector<std::string> names;
     std::vector<bool> isDir;
     if (!FileSystem::GetPathCompletions(listPath, prefix, names, isDir))
@@ -207,7 +172,12 @@ static bool TryPathCompletion(const std::string& line, int cursorPos, int& token
     }
     if (commonLen <= prefix.length())
     {
-        return false;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            candidates.push_back(pathPrefix + names[i] + (isDir[i] ? "\\" : ""));
+        }
+        replacement = candidates[0];
+        return true;
     }
     replacement = pathPrefix + names[0].substr(0, commonLen);
     return true;
@@ -220,6 +190,9 @@ static void InitTerminalBuffer()
     TerminalBuffer::Write("Welcome to TerminalX...\n");
     TerminalBuffer::Write("Type HELP for commands.\n");
     TerminalBuffer::Write("");
+    /* Finish a cross-volume MOVE that a power-off or crash cut short */
+    TerminalSink resumeOutput;
+    FileSystem::ResumeInterruptedMove(resumeOutput);
     TerminalBuffer::SetPrompt(CommandProcessor::GetCurrentDirForPrompt() + "> ");
     TerminalBuffer::SetCursor(0, TerminalBuffer::GetRows() - 1);
 }
@@ -268,7 +241,10 @@ static void SubmitCommand()
     }
 
     std::vector<std::string> args = CommandProcessor::ParseLine(line);
-    std::string result = CommandProcessor::Execute(args);
+    /* Streamed output starts on the last row, where WriteRaw of the result used to */
+    TerminalBuffer::SetCursor(0, TerminalBuffer::GetRows() - 1);
+    TerminalSink output;
+    std::string result = CommandProcessor::Execute(args, output);
     if (result.length() >= 1 && result[0] == '\x01')
     {
         TerminalBuffer::Clear();
@@ -354,6 +330,7 @@ bool CreateDevice()
 
 	Drawing::SetBufferWidth(displayModes[currentMode].dwWidth);
 	Drawing::SetBufferHeight(displayModes[currentMode].dwHeight);
+	Drawing::ResizeTerminalGeometry(TerminalBuffer::GetRows(), TerminalBuffer::GetCols());
 
 	D3DPRESENT_PARAMETERS params; 
     ZeroMemory(&params, sizeof(params));
@@ -385,7 +362,8 @@ bool CreateDevice()
 
 	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
 	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
-	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+	/* Glyph color comes from the vertex; the font atlas only supplies coverage in alpha */
+	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG2);
 	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
 	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
 	Drawing::GetD3dDevice()->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
@@ -423,6 +401,8 @@ void __cdecl main()
     InputManager::Init();
 
     DriveMount::Mount("HDD0-E");
+    /* The other drives are mounted on worker threads while the prompt comes up; DRIVES shows what they have found */
+    DriveMount::StartProbe();
 
 	InitTerminalBuffer();
 
@@ -436,6 +416,7 @@ void __cdecl main()
         {
             if (keyboardState.KeyDown)
             {
+                FrameScheduler::NotifyInput();
                 if (keyboardState.Ascii == '\r' || keyboardState.Ascii == '\n')
                 {
                     std::string line = TerminalBuffer::GetInputLine();
@@ -512,12 +493,24 @@ void __cdecl main()
                     TerminalBuffer::ScrollToBottom();
                     std::string line = TerminalBuffer::GetInputLine();
                     int cursorPos = TerminalBuffer::GetInputCursorPos();
-                    int tokenStart = 0;
-                    int tokenEnd = 0;
-                    std::string replacement;
-                    if (TryPathCompletion(line, cursorPos, tokenStart, tokenEnd, replacement))
+                    if (!s_tabCandidates.empty() && line == s_tabLine)
+                    {
+                        s_tabIndex = (s_tabIndex + 1) % s_tabCandidates.size();
+                        TerminalBuffer::ReplaceInputRange(s_tabTokenStart, cursorPos, s_tabCandidates[s_tabIndex]);
+                        s_tabLine = TerminalBuffer::GetInputLine();
+                    }
+                    else
                     {
-                        TerminalBuffer::ReplaceInputRange(tokenStart, tokenEnd, replacement);
+                        int tokenStart = 0;
+                        int tokenEnd = 0;
+                        std::string replacement;
+                        if (TryPathCompletion(line, cursorPos, tokenStart, tokenEnd, replacement, s_tabCandidates))
+                        {
+                            TerminalBuffer::ReplaceInputRange(tokenStart, tokenEnd, replacement);
+                            s_tabIndex = 0;
+                            s_tabTokenStart = tokenStart;
+                            s_tabLine = TerminalBuffer::GetInputLine();
+                        }
                     }
                 }
                 else if (keyboardState.Ascii >= 32 && keyboardState.Ascii <= 126)
@@ -534,12 +527,10 @@ void __cdecl main()
         }
 
         TerminalBuffer::UpdateInputRow();
-        DWORD tick = GetTickCount();
-        bool cursorOn = (tick % (CURSOR_BLINK_MS * 2)) < CURSOR_BLINK_MS;
-        int curX = TerminalBuffer::GetInputCursorX();
-        int curY = TerminalBuffer::GetInputCursorY();
-        Drawing::DrawTerminal(TerminalBuffer::GetBuffer(), TerminalBuffer::GetTextColor(), curX, curY, cursorOn);
-        Sleep(0);
+        if (!FrameScheduler::PresentIfNeeded())
+        {
+            FrameScheduler::WaitForWork();
+        }
     }
 
     HalReturnToFirmware(2);
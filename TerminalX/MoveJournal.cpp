@@ -0,0 +1,66 @@
+#include "MoveJournal.h"
+
+#define MOVE_JOURNAL_PATH "HDD0-E:\\TerminalX.jnl"
+#define MOVE_JOURNAL_HEADER "TXMOVE1"
+#define MOVE_JOURNAL_MAX_SIZE 2048
+
+#ifndef INVALID_HANDLE_VALUE
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+#endif
+
+bool MoveJournal::Begin(const std::string& srcApi, const std::string& dstApi)
+{
+    std::string text = std::string(MOVE_JOURNAL_HEADER) + "\n" + srcApi + "\n" + dstApi + "\n";
+    if (text.length() > MOVE_JOURNAL_MAX_SIZE)
+    {
+        return false;
+    }
+    HANDLE h = CreateFileA(MOVE_JOURNAL_PATH, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    DWORD written = 0;
+    bool ok = WriteFile(h, text.data(), (DWORD)text.length(), &written, NULL) && written == (DWORD)text.length();
+    ok = ok && FlushFileBuffers(h);
+    CloseHandle(h);
+    if (!ok)
+    {
+        DeleteFileA(MOVE_JOURNAL_PATH);
+    }
+    return ok;
+}
+
+void MoveJournal::End()
+{
+    DeleteFileA(MOVE_JOURNAL_PATH);
+}
+
+bool MoveJournal::GetPending(std::string& srcApi, std::string& dstApi)
+{
+    HANDLE h = CreateFileA(MOVE_JOURNAL_PATH, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    char buffer[MOVE_JOURNAL_MAX_SIZE];
+    DWORD got = 0;
+    BOOL ok = ReadFile(h, buffer, sizeof(buffer), &got, NULL);
+    CloseHandle(h);
+    if (!ok)
+    {
+        return false;
+    }
+    /* A journal torn by the interruption itself has no complete destination line and is ignored; the source is untouched in that case */
+    std::string text(buffer, got);
+    size_t first = text.find('\n');
+    size_t second = (first == std::string::npos) ? first : text.find('\n', first + 1);
+    size_t third = (second == std::string::npos) ? second : text.find('\n', second + 1);
+    if (third == std::string::npos || text.substr(0, first) != MOVE_JOURNAL_HEADER)
+    {
+        return false;
+    }
+    srcApi = text.substr(first + 1, second - first - 1);
+    dstApi = text.substr(second + 1, third - second - 1);
+    return !srcApi.empty() && !dstApi.empty();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "External.h"
+
+#include <string>
+
+/** Records the cross-volume move in progress in HDD0-E:\TerminalX.jnl, so a move cut short by a power-off or crash can be finished at the next start. */
+class MoveJournal
+{
+public:
+    /** Record a move of srcApi to dstApi, written through to disk before returning. Returns false if the journal cannot be written. */
+    static bool Begin(const std::string& srcApi, const std::string& dstApi);
+    /** Forget the recorded move once it has completed or failed cleanly. */
+    static void End();
+    /** Read the move left behind by an interrupted session. Returns false if there is none. */
+    static bool GetPending(std::string& srcApi, std::string& dstApi);
+};
@@ -0,0 +1,59 @@
+#include "OutputSink.h"
+#include "FrameScheduler.h"
+#include "TerminalBuffer.h"
+
+#define TERMINAL_SINK_PRESENT_MS 50
+
+void StringSink::Write(const char* text, size_t length)
+{
+    mText.append(text, length);
+}
+
+const std::string& StringSink::GetText() const
+{
+    return mText;
+}
+
+TerminalSink::TerminalSink()
+{
+    mLastPresent = GetTickCount();
+    mSavedAttr = TERMINAL_ATTR_DEFAULT;
+}
+
+void TerminalSink::Write(const char* text, size_t length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+    TerminalBuffer::WriteRaw(text, length);
+    DWORD tick = GetTickCount();
+    if ((DWORD)(tick - mLastPresent) >= TERMINAL_SINK_PRESENT_MS)
+    {
+        FrameScheduler::Present();
+        mLastPresent = tick;
+    }
+}
+
+void TerminalSink::SetHighlight(bool on)
+{
+    if (!on)
+    {
+        TerminalBuffer::SetWriteAttribute(mSavedAttr);
+        return;
+    }
+    mSavedAttr = TerminalBuffer::GetWriteAttribute();
+    /* Bright white, or light yellow / light aqua when COLOR already uses it; the background stays COLOR's, even after a later COLOR */
+    static const unsigned char highlights[] = { 0x0F, 0x0E, 0x0B };
+    unsigned char color = TerminalBuffer::GetColorAttribute();
+    unsigned char fg = highlights[0];
+    for (size_t i = 0; i < sizeof(highlights); i++)
+    {
+        fg = highlights[i];
+        if ((color & 0x0F) != fg && (color >> 4) != fg)
+        {
+            break;
+        }
+    }
+    TerminalBuffer::SetWriteAttribute(TERMINAL_ATTR_FOREGROUND(fg));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "External.h"
+
+#include <string>
+
+/** Destination for command output; commands write as they go instead of building one large string. */
+class OutputSink
+{
+public:
+    virtual ~OutputSink() {}
+    virtual void Write(const char* text, size_t length) = 0;
+    void Write(const std::string& text) { Write(text.data(), text.length()); }
+    /** Draw the text written until SetHighlight(false) in a highlight color (e.g. DIR's <DIR> entries); sinks without color ignore it. */
+    virtual void SetHighlight(bool on) {}
+};
+
+/** Collects output in memory, for callers that need the whole text. */
+class StringSink : public OutputSink
+{
+public:
+    using OutputSink::Write;
+    virtual void Write(const char* text, size_t length);
+    const std::string& GetText() const;
+
+private:
+    std::string mText;
+};
+
+/** Appends output straight to TerminalBuffer and presents a frame at most every TERMINAL_SINK_PRESENT_MS while a command runs. */
+class TerminalSink : public OutputSink
+{
+public:
+    TerminalSink();
+    using OutputSink::Write;
+    virtual void Write(const char* text, size_t length);
+    virtual void SetHighlight(bool on);
+
+private:
+    DWORD mLastPresent;
+    unsigned char mSavedAttr;
+};
@@ -0,0 +1,108 @@
+#include "PathResolver.h"
+#include "DriveMount.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#define PATH_RESOLVER_BUFFER 512
+
+static bool IsSeparator(char c)
+{
+    return c == '\\' || c == '/';
+}
+
+size_t PathResolver::AppendComponents(char* buffer, size_t length, size_t rootLength, const char* text, size_t textLength)
+{
+    size_t i = 0;
+    while (i < textLength)
+    {
+        while (i < textLength && IsSeparator(text[i]))
+        {
+            i++;
+        }
+        size_t start = i;
+        while (i < textLength && !IsSeparator(text[i]))
+        {
+            i++;
+        }
+        size_t n = i - start;
+        if (n == 0 || (n == 1 && text[start] == '.'))
+        {
+            continue;
+        }
+        if (n == 2 && text[start] == '.' && text[start + 1] == '.')
+        {
+            /* Drop the last component, but never climb above the drive */
+            while (length > rootLength && buffer[length - 1] != '\\')
+            {
+                length--;
+            }
+            if (length > rootLength)
+            {
+                length--;
+            }
+            continue;
+        }
+        buffer[length++] = '\\';
+        memcpy(buffer + length, text + start, n);
+        length += n;
+    }
+    return length;
+}
+
+bool PathResolver::Resolve(const std::string& pathArg, const std::string& currentDir, std::string& outPath)
+{
+    /* Each component gains at most one separator, so the result never outgrows the two inputs plus two characters */
+    char stackBuffer[PATH_RESOLVER_BUFFER];
+    std::string longPath;
+    char* buffer = stackBuffer;
+    size_t capacity = currentDir.length() + pathArg.length() + 2;
+    if (capacity > sizeof(stackBuffer))
+    {
+        longPath.resize(capacity);
+        buffer = &longPath[0];
+    }
+
+    const char* arg = pathArg.data();
+    size_t argLength = pathArg.length();
+    const char* colon = (const char*)memchr(arg, ':', argLength);
+    size_t length = 0;
+    bool mounted = true;
+    if (colon != NULL && colon != arg)
+    {
+        while (arg + length < colon)
+        {
+            buffer[length] = (char)toupper((unsigned char)arg[length]);
+            length++;
+        }
+        mounted = DriveMount::EnsureMounted(std::string(buffer, length));
+        argLength -= length + 1;
+        arg = colon + 1;
+        length = AppendComponents(buffer, length, length, arg, argLength);
+    }
+    else
+    {
+        if (colon != NULL)
+        {
+            arg++;
+            argLength--;
+        }
+        /* currentDir is kept as "HDD0-E\dir\"; a drive written as "HDD0-E:\dir" is read the same way */
+        const char* current = currentDir.data();
+        size_t currentLength = currentDir.length();
+        while (length < currentLength && !IsSeparator(current[length]) && current[length] != ':')
+        {
+            buffer[length] = current[length];
+            length++;
+        }
+        size_t rootLength = length;
+        if (argLength == 0 || !IsSeparator(arg[0]))
+        {
+            size_t skip = (length < currentLength && current[length] == ':') ? length + 1 : length;
+            length = AppendComponents(buffer, length, rootLength, current + skip, currentLength - skip);
+        }
+        length = AppendComponents(buffer, length, rootLength, arg, argLength);
+    }
+    outPath.assign(buffer, length);
+    return mounted;
+}
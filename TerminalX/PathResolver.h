@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+/** Turns a path argument into the internal form FileSystem takes ("HDD0-E\Games\a.xbe") in one pass, folding ".", "..", '/' and repeated separators. */
+class PathResolver
+{
+public:
+    /** Resolve pathArg against currentDir. "hdd0-e:x" starts at the root of that drive and mounts it through DriveMount::EnsureMounted; "\x" starts at the root of the current drive. The result has no trailing separator, so a volume root is the bare drive name ("HDD0-E"). Returns false if a named drive is unknown or cannot be mounted; outPath is filled in either way. */
+    static bool Resolve(const std::string& pathArg, const std::string& currentDir, std::string& outPath);
+
+private:
+    static size_t AppendComponents(char* buffer, size_t length, size_t rootLength, const char* text, size_t textLength);
+};
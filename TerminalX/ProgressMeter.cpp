@@ -0,0 +1,59 @@
+#include "ProgressMeter.h"
+#include "String.h"
+
+#define PROGRESS_METER_DELAY_MS 500
+#define PROGRESS_METER_INTERVAL_MS 250
+
+ProgressMeter::ProgressMeter(OutputSink* output, unsigned __int64 total)
+    : mOutput(output), mTotal(total), mStart(GetTickCount()), mLastPrint(0), mShown(false)
+{
+}
+
+void ProgressMeter::Update(unsigned __int64 done)
+{
+    if (mOutput == NULL)
+    {
+        return;
+    }
+    DWORD now = GetTickCount();
+    if ((DWORD)(now - mStart) < PROGRESS_METER_DELAY_MS || (mShown && (DWORD)(now - mLastPrint) < PROGRESS_METER_INTERVAL_MS))
+    {
+        return;
+    }
+    Print(done, now);
+}
+
+void ProgressMeter::Finish(unsigned __int64 done, bool completed)
+{
+    if (!mShown)
+    {
+        return;
+    }
+    if (completed)
+    {
+        Print(done, GetTickCount());
+    }
+    mOutput->Write("\n", 1);
+}
+
+void ProgressMeter::Print(unsigned __int64 done, DWORD now)
+{
+    DWORD elapsed = now - mStart;
+    double doneMb = (double)(__int64)done / (1024.0 * 1024.0);
+    double totalMb = (double)(__int64)mTotal / (1024.0 * 1024.0);
+    double rate = (elapsed > 0) ? doneMb * 1000.0 / (double)elapsed : 0.0;
+    unsigned int percent = (mTotal > 0) ? (unsigned int)(done * 100 / mTotal) : 100;
+    std::string eta = "-:--";
+    if (done >= mTotal)
+    {
+        eta = "0:00";
+    }
+    else if (rate > 0.0)
+    {
+        unsigned int seconds = (unsigned int)((totalMb - doneMb) / rate + 0.5);
+        eta = String::Format("%u:%02u", seconds / 60, seconds % 60);
+    }
+    mOutput->Write(String::Format("\r%3u%%  %.1f of %.1f MB  %.1f MB/s  ETA %s   ", percent, doneMb, totalMb, rate, eta.c_str()));
+    mLastPrint = now;
+    mShown = true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "External.h"
+#include "OutputSink.h"
+
+/** A "\r" progress line (percent, MB done, MB/s, ETA) for one long operation. Stays silent for the first PROGRESS_METER_DELAY_MS and then redraws at most every PROGRESS_METER_INTERVAL_MS. */
+class ProgressMeter
+{
+public:
+    /** output may be NULL for no progress; total is the number of bytes expected. */
+    ProgressMeter(OutputSink* output, unsigned __int64 total);
+
+    void Update(unsigned __int64 done);
+    /** End the progress line, if one was shown; the final figures are only printed for a completed operation. */
+    void Finish(unsigned __int64 done, bool completed);
+
+private:
+    void Print(unsigned __int64 done, DWORD now);
+
+    OutputSink* mOutput;
+    unsigned __int64 mTotal;
+    DWORD mStart;
+    DWORD mLastPrint;
+    bool mShown;
+};
@@ -3,3 +3,6 @@
 //https://notisrac.github.io/FileToCArray/
 
 #include "Assets/Font/Terminal_sfn.h"
+
+// Generated by FontBaker (see FontBaker\runme.bat)
+#include "Assets/Font/Terminal_atlas.h"
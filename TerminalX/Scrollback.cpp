@@ -0,0 +1,301 @@
+#include "Scrollback.h"
+#include "TerminalBuffer.h"
+
+/*
+ * Line encoding inside a chunk:
+ *   header  1 byte encoded length, or 0xFF followed by a 16-bit little-endian length
+ *   body    0x00-0x7F literal, 0x80 escape (next byte is a literal 0x80-0xFF),
+ *           0x81 attribute change (next byte applies to the following cells; a line starts at
+ *           TERMINAL_ATTR_DEFAULT), 0x82-0xFF run of (byte - 0x80) spaces (2..127)
+ */
+#define SCROLLBACK_CHUNK_BYTES 8192
+#define SCROLLBACK_CHUNK_MAX_LINES 4096
+/** Every Nth line in a chunk records its byte offset, so a lookup walks at most N-1 headers */
+#define SCROLLBACK_MARK_INTERVAL 16
+#define SCROLLBACK_ESCAPE 0x80
+#define SCROLLBACK_ATTR 0x81
+#define SCROLLBACK_SPACE_RUN_MAX 127
+/** Worst case: 3-byte header plus an attribute change and an escape on every cell */
+#define SCROLLBACK_MAX_ENCODED_LINE (3 + (TERMINAL_MAX_COLS * 4))
+
+namespace
+{
+    struct ScrollbackChunk
+    {
+        uint32_t firstLine;  /* absolute number of the first line stored here */
+        unsigned short lineCount;
+        unsigned short used;
+        unsigned short marks[SCROLLBACK_CHUNK_MAX_LINES / SCROLLBACK_MARK_INTERVAL];
+        unsigned char data[SCROLLBACK_CHUNK_BYTES];
+    };
+
+    #define SCROLLBACK_MAX_CHUNKS (TERMINAL_SCROLLBACK_MAX_BYTES / sizeof(ScrollbackChunk))
+
+    /* Ring of chunk slots; live chunks are s_chunkHead .. s_chunkHead + s_chunkCount - 1 */
+    ScrollbackChunk* s_chunks[SCROLLBACK_MAX_CHUNKS];
+    int s_chunkHead = 0;
+    int s_chunkCount = 0;
+    uint32_t s_firstLine = 0;  /* absolute number of the oldest retained line */
+    uint32_t s_nextLine = 0;   /* absolute number the next pushed line gets */
+    uint32_t s_allocatedBytes = 0;
+}
+
+static ScrollbackChunk* ChunkAt(int i)
+{
+    return s_chunks[(s_chunkHead + i) % SCROLLBACK_MAX_CHUNKS];
+}
+
+static void DropOldestChunk()
+{
+    s_chunkHead = (s_chunkHead + 1) % SCROLLBACK_MAX_CHUNKS;
+    s_chunkCount--;
+    if (s_chunkCount > 0)
+    {
+        uint32_t first = ChunkAt(0)->firstLine;
+        if (s_firstLine < first)
+        {
+            s_firstLine = first;
+        }
+    }
+    else
+    {
+        s_firstLine = s_nextLine;
+    }
+}
+
+/** Start a new tail chunk, recycling the oldest one when the byte budget is used up. Returns NULL only if no memory at all. */
+static ScrollbackChunk* BeginChunk()
+{
+    if (s_chunkCount == (int)SCROLLBACK_MAX_CHUNKS)
+    {
+        DropOldestChunk();
+    }
+    int tail = (s_chunkHead + s_chunkCount) % SCROLLBACK_MAX_CHUNKS;
+    if (s_chunks[tail] == NULL)
+    {
+        s_chunks[tail] = (ScrollbackChunk*)malloc(sizeof(ScrollbackChunk));
+        if (s_chunks[tail] != NULL)
+        {
+            s_allocatedBytes += (uint32_t)sizeof(ScrollbackChunk);
+        }
+        else if (s_chunkCount > 0)
+        {
+            /* Out of memory: take over the oldest chunk instead */
+            int oldest = s_chunkHead;
+            DropOldestChunk();
+            tail = (s_chunkHead + s_chunkCount) % SCROLLBACK_MAX_CHUNKS;
+            s_chunks[tail] = s_chunks[oldest];
+            s_chunks[oldest] = NULL;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+    ScrollbackChunk* chunk = s_chunks[tail];
+    chunk->firstLine = s_nextLine;
+    chunk->lineCount = 0;
+    chunk->used = 0;
+    s_chunkCount++;
+    return chunk;
+}
+
+static int EncodeLine(const char* text, const unsigned char* attrs, int length, unsigned char* out)
+{
+    int n = 0;
+    int i = 0;
+    unsigned char attr = TERMINAL_ATTR_DEFAULT;
+    while (i < length)
+    {
+        if (attrs[i] != attr)
+        {
+            attr = attrs[i];
+            out[n++] = SCROLLBACK_ATTR;
+            out[n++] = attr;
+        }
+        unsigned char c = (unsigned char)text[i];
+        if (c == ' ')
+        {
+            int run = 1;
+            while (i + run < length && run < SCROLLBACK_SPACE_RUN_MAX && text[i + run] == ' ' && attrs[i + run] == attr)
+            {
+                run++;
+            }
+            out[n++] = (run == 1) ? (unsigned char)' ' : (unsigned char)(0x80 + run);
+            i += run;
+            continue;
+        }
+        if (c >= 0x80)
+        {
+            out[n++] = SCROLLBACK_ESCAPE;
+        }
+        out[n++] = c;
+        i++;
+    }
+    return n;
+}
+
+/** Read a line header at offset; returns the body length and advances offset past the header. */
+static int ReadHeader(const unsigned char* data, int& offset)
+{
+    int length = data[offset++];
+    if (length == 0xFF)
+    {
+        length = data[offset] | (data[offset + 1] << 8);
+        offset += 2;
+    }
+    return length;
+}
+
+void Scrollback::Clear()
+{
+    s_chunkHead = 0;
+    s_chunkCount = 0;
+    s_firstLine = 0;
+    s_nextLine = 0;
+}
+
+void Scrollback::PushLine(const char* text, const unsigned char* attrs, int length)
+{
+    /* Trailing spaces are only invisible when they carry the default attribute */
+    while (length > 0 && text[length - 1] == ' ' && attrs[length - 1] == TERMINAL_ATTR_DEFAULT)
+    {
+        length--;
+    }
+    if (length > TERMINAL_MAX_COLS)
+    {
+        length = TERMINAL_MAX_COLS;
+    }
+
+    unsigned char body[SCROLLBACK_MAX_ENCODED_LINE];
+    int bodyLength = EncodeLine(text, attrs, length, body);
+    int headerLength = (bodyLength < 0xFF) ? 1 : 3;
+
+    ScrollbackChunk* chunk = (s_chunkCount > 0) ? ChunkAt(s_chunkCount - 1) : NULL;
+    if (chunk == NULL || chunk->lineCount >= SCROLLBACK_CHUNK_MAX_LINES ||
+        chunk->used + headerLength + bodyLength > SCROLLBACK_CHUNK_BYTES)
+    {
+        chunk = BeginChunk();
+        if (chunk == NULL)
+        {
+            return;
+        }
+    }
+
+    if ((chunk->lineCount % SCROLLBACK_MARK_INTERVAL) == 0)
+    {
+        chunk->marks[chunk->lineCount / SCROLLBACK_MARK_INTERVAL] = chunk->used;
+    }
+    unsigned char* dst = &chunk->data[chunk->used];
+    if (headerLength == 1)
+    {
+        dst[0] = (unsigned char)bodyLength;
+    }
+    else
+    {
+        dst[0] = 0xFF;
+        dst[1] = (unsigned char)(bodyLength & 0xFF);
+        dst[2] = (unsigned char)(bodyLength >> 8);
+    }
+    memcpy(dst + headerLength, body, (size_t)bodyLength);
+    chunk->used = (unsigned short)(chunk->used + headerLength + bodyLength);
+    chunk->lineCount++;
+    s_nextLine++;
+
+    /* Line limit: retire the oldest line, and its chunk once every line in it is gone */
+    if (s_nextLine - s_firstLine > TERMINAL_SCROLLBACK_MAX_ROWS)
+    {
+        s_firstLine++;
+        ScrollbackChunk* oldest = ChunkAt(0);
+        if (s_firstLine >= oldest->firstLine + oldest->lineCount)
+        {
+            DropOldestChunk();
+        }
+    }
+}
+
+int Scrollback::GetLineCount()
+{
+    return (int)(s_nextLine - s_firstLine);
+}
+
+void Scrollback::CopyLine(int index, char* dst, unsigned char* dstAttrs, int cols)
+{
+    if (index < 0 || index >= GetLineCount() || s_chunkCount == 0)
+    {
+        memset(dst, ' ', (size_t)cols);
+        memset(dstAttrs, TERMINAL_ATTR_DEFAULT, (size_t)cols);
+        return;
+    }
+    uint32_t line = s_firstLine + (uint32_t)index;
+
+    /* Last chunk whose first line is <= line */
+    int lo = 0;
+    int hi = s_chunkCount - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (ChunkAt(mid)->firstLine <= line)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    const ScrollbackChunk* chunk = ChunkAt(lo);
+    int local = (int)(line - chunk->firstLine);
+
+    int offset = chunk->marks[local / SCROLLBACK_MARK_INTERVAL];
+    for (int skip = local % SCROLLBACK_MARK_INTERVAL; skip > 0; skip--)
+    {
+        int length = ReadHeader(chunk->data, offset);
+        offset += length;
+    }
+    int length = ReadHeader(chunk->data, offset);
+    const unsigned char* src = &chunk->data[offset];
+    const unsigned char* end = src + length;
+
+    int col = 0;
+    unsigned char attr = TERMINAL_ATTR_DEFAULT;
+    while (src < end && col < cols)
+    {
+        unsigned char c = *src++;
+        if (c == SCROLLBACK_ATTR)
+        {
+            attr = *src++;
+        }
+        else if (c == SCROLLBACK_ESCAPE)
+        {
+            dstAttrs[col] = attr;
+            dst[col++] = (char)*src++;
+        }
+        else if (c > SCROLLBACK_ATTR)
+        {
+            int run = c - 0x80;
+            if (run > cols - col)
+            {
+                run = cols - col;
+            }
+            memset(dst + col, ' ', (size_t)run);
+            memset(dstAttrs + col, attr, (size_t)run);
+            col += run;
+        }
+        else
+        {
+            dstAttrs[col] = attr;
+            dst[col++] = (char)c;
+        }
+    }
+    if (col < cols)
+    {
+        memset(dst + col, ' ', (size_t)(cols - col));
+        memset(dstAttrs + col, TERMINAL_ATTR_DEFAULT, (size_t)(cols - col));
+    }
+}
+
+uint32_t Scrollback::GetAllocatedBytes()
+{
+    return s_allocatedBytes;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "External.h"
+
+/** History lines scrolled off the top of the terminal, stored trimmed and space-compressed in fixed-size chunks. */
+class Scrollback
+{
+public:
+    /** Drop all lines (chunk memory is kept for reuse). */
+    static void Clear();
+    /** Append one row of text and its cell attributes; trailing default spaces are not stored. Oldest lines are dropped past the line or byte limit. */
+    static void PushLine(const char* text, const unsigned char* attrs, int length);
+    static int GetLineCount();
+    /** Decode line index (0 = oldest) into dst and dstAttrs, padded with default spaces to cols. */
+    static void CopyLine(int index, char* dst, unsigned char* dstAttrs, int cols);
+    /** Bytes of chunk memory currently allocated. */
+    static uint32_t GetAllocatedBytes();
+};
@@ -0,0 +1,106 @@
+#include "StatCache.h"
+#include "Debug.h"
+#include "String.h"
+
+#include <map>
+
+/* Recursive listings stop adding entries past this, so DEL /S or CRC /S over a large tree stays small */
+#define STAT_CACHE_MAX_ENTRIES 4096
+
+namespace
+{
+    /** A cached lookup; error is GetLastError() from a failed one, restored when it is answered again */
+    struct StatCacheEntry
+    {
+        DWORD attributes;
+        DWORD error;
+    };
+
+    std::map<std::string, StatCacheEntry> s_attributes;     /* keyed by upper-cased API path */
+    int s_depth = 0;
+    unsigned int s_lookups = 0;                     /* GetAttributes calls during the scope */
+    unsigned int s_calls = 0;                       /* of those, the ones that reached GetFileAttributesA */
+}
+
+DWORD StatCache::GetAttributes(const std::string& apiPath)
+{
+    if (s_depth == 0)
+    {
+        return GetFileAttributesA(apiPath.c_str());
+    }
+    s_lookups++;
+    std::string key = String::ToUpper(apiPath);
+    std::map<std::string, StatCacheEntry>::const_iterator it = s_attributes.find(key);
+    if (it != s_attributes.end())
+    {
+        if (it->second.attributes == 0xFFFFFFFF)
+        {
+            SetLastError(it->second.error);
+        }
+        return it->second.attributes;
+    }
+    s_calls++;
+    StatCacheEntry entry;
+    entry.attributes = GetFileAttributesA(apiPath.c_str());
+    entry.error = (entry.attributes == 0xFFFFFFFF) ? GetLastError() : ERROR_SUCCESS;
+    if (s_attributes.size() < STAT_CACHE_MAX_ENTRIES)
+    {
+        s_attributes[key] = entry;
+    }
+    if (entry.attributes == 0xFFFFFFFF)
+    {
+        SetLastError(entry.error);
+    }
+    return entry.attributes;
+}
+
+void StatCache::Remember(const std::string& apiPath, DWORD attributes)
+{
+    if (s_depth == 0 || s_attributes.size() >= STAT_CACHE_MAX_ENTRIES)
+    {
+        return;
+    }
+    StatCacheEntry entry;
+    entry.attributes = attributes;
+    entry.error = ERROR_SUCCESS;
+    s_attributes[String::ToUpper(apiPath)] = entry;
+}
+
+void StatCache::Invalidate(const std::string& apiPath)
+{
+    if (s_attributes.empty())
+    {
+        return;
+    }
+    std::string key = String::ToUpper(apiPath);
+    s_attributes.erase(key);
+    /* Entries below a directory sort right after "KEY\" */
+    std::string prefix = (key.length() > 0 && key[key.length() - 1] == '\\') ? key : key + "\\";
+    std::map<std::string, StatCacheEntry>::iterator it = s_attributes.lower_bound(prefix);
+    while (it != s_attributes.end() && it->first.compare(0, prefix.length(), prefix) == 0)
+    {
+        s_attributes.erase(it++);
+    }
+}
+
+void StatCache::BeginScope()
+{
+    if (s_depth++ == 0)
+    {
+        s_lookups = 0;
+        s_calls = 0;
+    }
+}
+
+void StatCache::EndScope(const std::string& command)
+{
+    if (--s_depth > 0)
+    {
+        return;
+    }
+    s_attributes.clear();
+    if (s_lookups > 0)
+    {
+        Debug::Print("StatCache: %s made %u attribute lookups, %u reached GetFileAttributes\n", command.c_str(), s_lookups, s_calls);
+    }
+}
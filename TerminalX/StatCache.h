@@ -0,0 +1,35 @@
+#pragma once
+
+#include "External.h"
+
+#include <string>
+
+/** File attributes looked up during one command, so the same path is only walked once however many times the command and FileSystem ask about it. Only active inside a StatCacheScope; main thread only. */
+class StatCache
+{
+public:
+    /** GetFileAttributesA(apiPath), answered from the cache when a scope is active. Returns 0xFFFFFFFF if the path does not exist, with GetLastError() set as the uncached call would have left it. */
+    static DWORD GetAttributes(const std::string& apiPath);
+    /** Record attributes already known from a directory listing. */
+    static void Remember(const std::string& apiPath, DWORD attributes);
+    /** Forget apiPath and everything below it; called after anything that creates, deletes, moves or changes it. */
+    static void Invalidate(const std::string& apiPath);
+
+    static void BeginScope();
+    /** Drop the cache and log the lookup counters for command to the debug output. */
+    static void EndScope(const std::string& command);
+};
+
+/** Keeps StatCache active for the lifetime of one command execution. */
+class StatCacheScope
+{
+public:
+    explicit StatCacheScope(const std::string& command) : mCommand(command) { StatCache::BeginScope(); }
+    ~StatCacheScope() { StatCache::EndScope(mCommand); }
+
+private:
+    StatCacheScope(const StatCacheScope&);
+    StatCacheScope& operator=(const StatCacheScope&);
+
+    std::string mCommand;
+};
@@ -0,0 +1,186 @@
+#include "Swizzler.h"
+
+#include <vector>
+
+/** Largest texture side handled with offset tables; bigger images use TexelOffset per texel */
+#define SWIZZLE_MAX_DIMENSION 4096
+
+namespace
+{
+    uint16_t s_spreadByte[256];  /* bit i of the index moved to bit 2i */
+    bool s_spreadBuilt = false;
+    std::vector<uint32_t> s_xTable;  /* per-column / per-row offsets for s_tableWidth x s_tableHeight */
+    std::vector<uint32_t> s_yTable;
+    uint32_t s_tableWidth = 0;
+    uint32_t s_tableHeight = 0;
+}
+
+static void BuildSpreadTable()
+{
+    if (s_spreadBuilt)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t spread = 0;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            spread |= ((i >> bit) & 1) << (2 * bit);
+        }
+        s_spreadByte[i] = (uint16_t)spread;
+    }
+    s_spreadBuilt = true;
+}
+
+/** Interleave the low 16 bits of v with zeros (bit i to bit 2i). */
+static uint32_t Spread(uint32_t v)
+{
+    return (uint32_t)s_spreadByte[v & 0xFF] | ((uint32_t)s_spreadByte[(v >> 8) & 0xFF] << 16);
+}
+
+/* Per-axis offsets; match the original Drawing::Swizzle addressing, including its handling of non-square textures */
+static uint32_t SwizzleX(uint32_t x, uint32_t height)
+{
+    if (x < height * 2)
+    {
+        return Spread(x);
+    }
+    return Spread(x % (2 * height)) + (x / (2 * height)) * 2 * height * height;
+}
+
+static uint32_t SwizzleY(uint32_t y, uint32_t width)
+{
+    if (y < width)
+    {
+        return Spread(y) << 1;
+    }
+    return (Spread(y % width) << 1) + (y / width) * width * width;
+}
+
+static bool IsPowerOfTwo(uint32_t v)
+{
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+uint32_t Swizzler::TexelOffset(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    BuildSpreadTable();
+    return SwizzleX(x, height) + SwizzleY(y, width);
+}
+
+/** Power-of-two sides with width <= 2 * height <= 4 * width: each 2x2 block lands in 4 consecutive texels. */
+template <typename Texel>
+static void SwizzleBlocks(const uint8_t* src, uint32_t srcPitch, uint32_t width, uint32_t height, Texel* dest)
+{
+    for (uint32_t y = 0; y < height; y += 2)
+    {
+        const Texel* row0 = (const Texel*)(src + y * srcPitch);
+        const Texel* row1 = (const Texel*)(src + (y + 1) * srcPitch);
+        uint32_t sy = Spread(y) << 1;
+        for (uint32_t x = 0; x < width; x += 2)
+        {
+            Texel* d = dest + (Spread(x) + sy);
+            d[0] = row0[x];
+            d[1] = row0[x + 1];
+            d[2] = row1[x];
+            d[3] = row1[x + 1];
+        }
+    }
+}
+
+template <typename Texel>
+static void SwizzleTexels(const uint8_t* src, uint32_t srcPitch, uint32_t width, uint32_t height, const uint32_t* xTable, const uint32_t* yTable, Texel* dest)
+{
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const Texel* s = (const Texel*)(src + y * srcPitch);
+        Texel* d = dest + yTable[y];
+        for (uint32_t x = 0; x < width; x++)
+        {
+            d[xTable[x]] = s[x];
+        }
+    }
+}
+
+void Swizzler::Swizzle(const void* src, uint32_t srcPitch, uint32_t depth, uint32_t width, uint32_t height, void* dest)
+{
+    BuildSpreadTable();
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+    const uint8_t* s = (const uint8_t*)src;
+
+    bool blocks = IsPowerOfTwo(width) && IsPowerOfTwo(height) && width >= 2 && height >= 2 &&
+        width <= height * 2 && height <= width;
+    if (blocks && depth == 4)
+    {
+        SwizzleBlocks<uint32_t>(s, srcPitch, width, height, (uint32_t*)dest);
+        return;
+    }
+    if (blocks && depth == 2)
+    {
+        SwizzleBlocks<uint16_t>(s, srcPitch, width, height, (uint16_t*)dest);
+        return;
+    }
+    if (blocks && depth == 1)
+    {
+        SwizzleBlocks<uint8_t>(s, srcPitch, width, height, (uint8_t*)dest);
+        return;
+    }
+
+    if (width > SWIZZLE_MAX_DIMENSION || height > SWIZZLE_MAX_DIMENSION)
+    {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                memcpy((uint8_t*)dest + TexelOffset(x, y, width, height) * depth, s + y * srcPitch + x * depth, depth);
+            }
+        }
+        return;
+    }
+
+    /* Kept between calls: the same texture size is usually swizzled again */
+    if (width != s_tableWidth || height != s_tableHeight)
+    {
+        s_xTable.resize(width);
+        s_yTable.resize(height);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            s_xTable[x] = SwizzleX(x, height);
+        }
+        for (uint32_t y = 0; y < height; y++)
+        {
+            s_yTable[y] = SwizzleY(y, width);
+        }
+        s_tableWidth = width;
+        s_tableHeight = height;
+    }
+    const uint32_t* xTable = &s_xTable[0];
+    const uint32_t* yTable = &s_yTable[0];
+
+    if (depth == 4)
+    {
+        SwizzleTexels<uint32_t>(s, srcPitch, width, height, xTable, yTable, (uint32_t*)dest);
+    }
+    else if (depth == 2)
+    {
+        SwizzleTexels<uint16_t>(s, srcPitch, width, height, xTable, yTable, (uint16_t*)dest);
+    }
+    else if (depth == 1)
+    {
+        SwizzleTexels<uint8_t>(s, srcPitch, width, height, xTable, yTable, (uint8_t*)dest);
+    }
+    else
+    {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                memcpy((uint8_t*)dest + (xTable[x] + yTable[y]) * depth, s + y * srcPitch + x * depth, depth);
+            }
+        }
+    }
+}
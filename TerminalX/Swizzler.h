@@ -0,0 +1,13 @@
+#pragma once
+
+#include "External.h"
+
+/** Converts linear images to the swizzled (Morton order) texel layout used by Xbox textures. */
+class Swizzler
+{
+public:
+    /** Swizzle a linear width x height image (srcPitch bytes per row, depth bytes per texel) into dest. */
+    static void Swizzle(const void* src, uint32_t srcPitch, uint32_t depth, uint32_t width, uint32_t height, void* dest);
+    /** Texel index of (x, y) in a swizzled width x height texture (multiply by depth for a byte offset). */
+    static uint32_t TexelOffset(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+};
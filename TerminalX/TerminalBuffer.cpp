@@ -1,23 +1,26 @@
 #include "TerminalBuffer.h"
 #include "Drawing.h"
+#include "Scrollback.h"
 
 namespace
 {
     char* s_buffer = NULL;
     char* s_baseBuffer = NULL;
-    char* s_scrollback = NULL;
+    unsigned char* s_attrBuffer = NULL;  /* view attribute plane, parallel to s_buffer */
+    unsigned char* s_baseAttrs = NULL;   /* base attribute plane, parallel to s_baseBuffer (same row ring) */
+    int s_baseHead = 0;  /* physical row holding base row 0; ScrollUp advances it instead of moving rows */
     int s_allocRows = 0;
     int s_allocCols = 0;
     int s_cursor_x = 0;
     int s_cursor_y = 0;
-    int s_scrollbackCount = 0;
-    int s_scrollbackStart = 0;
     int s_scrollOffset = 0;
     std::string s_prompt = "C:\\> ";
     std::string s_inputLine;
     int s_inputCursorPos = 0;  /* position within input line (0..length) */
     unsigned char s_colorAttr = 0x0A;
     unsigned char s_colorAttrDefault = 0x0A;
+    unsigned char s_writeAttr = TERMINAL_ATTR_DEFAULT;
+    uint32_t s_dirtyRows[TERMINAL_DIRTY_WORDS];
 
     static const unsigned int s_colorTable[16] =
     {
@@ -28,6 +31,60 @@ namespace
     };
 }
 
+/** Offset of base buffer row (0 = top, rows-1 = input row) resolved through the row ring. */
+static int BaseRowOffset(int row)
+{
+    int phys = s_baseHead + row;
+    if (phys >= s_allocRows)
+    {
+        phys -= s_allocRows;
+    }
+    return phys * s_allocCols;
+}
+
+static char* BaseRow(int row)
+{
+    return &s_baseBuffer[BaseRowOffset(row)];
+}
+
+static unsigned char* BaseAttrRow(int row)
+{
+    return &s_baseAttrs[BaseRowOffset(row)];
+}
+
+static void MarkViewRowDirty(int viewRow)
+{
+    if (viewRow >= 0 && viewRow < TERMINAL_MAX_ROWS)
+    {
+        s_dirtyRows[viewRow >> 5] |= (1u << (viewRow & 31));
+    }
+}
+
+/** Base buffer row changed: mark the view row it is shown on (input row is always the last view row). */
+static void MarkBaseRowDirty(int baseRow)
+{
+    int rows = TerminalBuffer::GetRows();
+    if (baseRow == rows - 1)
+    {
+        MarkViewRowDirty(baseRow);
+        return;
+    }
+    int viewRow = baseRow + s_scrollOffset;
+    if (viewRow < rows - 1)
+    {
+        MarkViewRowDirty(viewRow);
+    }
+}
+
+static void SetScrollOffset(int offset)
+{
+    if (offset != s_scrollOffset)
+    {
+        s_scrollOffset = offset;
+        TerminalBuffer::MarkAllRowsDirty();
+    }
+}
+
 void TerminalBuffer::SetColorAttribute(unsigned char attr)
 {
     s_colorAttr = attr;
@@ -43,6 +100,21 @@ unsigned char TerminalBuffer::GetColorAttribute()
     return s_colorAttr;
 }
 
+void TerminalBuffer::SetWriteAttribute(unsigned char attr)
+{
+    s_writeAttr = attr;
+}
+
+unsigned char TerminalBuffer::GetWriteAttribute()
+{
+    return s_writeAttr;
+}
+
+unsigned int TerminalBuffer::GetPaletteColor(int index)
+{
+    return s_colorTable[index & 0x0F];
+}
+
 unsigned int TerminalBuffer::GetTextColor()
 {
     return s_colorTable[s_colorAttr & 0x0F];
@@ -69,16 +141,19 @@ void TerminalBuffer::Init()
     {
         free(s_buffer);
         free(s_baseBuffer);
-        free(s_scrollback);
+        free(s_attrBuffer);
+        free(s_baseAttrs);
     }
     s_allocRows = rows;
     s_allocCols = cols;
     s_buffer = (char*)malloc((size_t)(rows * cols));
     s_baseBuffer = (char*)malloc((size_t)(rows * cols));
-    s_scrollback = (char*)malloc((size_t)(TERMINAL_SCROLLBACK_MAX_ROWS * TERMINAL_MAX_COLS));
-    s_scrollbackCount = 0;
-    s_scrollbackStart = 0;
+    s_attrBuffer = (unsigned char*)malloc((size_t)(rows * cols));
+    s_baseAttrs = (unsigned char*)malloc((size_t)(rows * cols));
+    s_baseHead = 0;
+    Scrollback::Clear();
     s_scrollOffset = 0;
+    MarkAllRowsDirty();
 }
 
 void TerminalBuffer::Clear()
@@ -86,18 +161,14 @@ void TerminalBuffer::Clear()
     Init();
     int rows = GetRows();
     int cols = GetCols();
-    for (int row = 0; row < rows; row++)
-    {
-        for (int col = 0; col < cols; col++)
-        {
-            s_baseBuffer[(row * cols) + col] = ' ';
-        }
-    }
+    memset(s_baseBuffer, ' ', (size_t)(rows * cols));
+    memset(s_baseAttrs, TERMINAL_ATTR_DEFAULT, (size_t)(rows * cols));
+    s_baseHead = 0;
     s_cursor_x = 0;
     s_cursor_y = 0;
-    s_scrollbackCount = 0;
-    s_scrollbackStart = 0;
+    Scrollback::Clear();
     s_scrollOffset = 0;
+    MarkAllRowsDirty();
 }
 
 void TerminalBuffer::SetCursor(int x, int y)
@@ -106,84 +177,95 @@ void TerminalBuffer::SetCursor(int x, int y)
     s_cursor_y = (y >= 0 && y < GetRows()) ? y : 0;
 }
 
-void TerminalBuffer::Write(std::string message, ...)
+static void NewLine()
 {
-    Init();
-
-    char buffer[1024];
-    va_list arglist;
-    va_start(arglist, message);
-    _vsnprintf(buffer, 1024, message.c_str(), arglist);
-    va_end(arglist);
-    buffer[1024 - 1] = '\0';
+    s_cursor_x = 0;
+    s_cursor_y++;
+    if (s_cursor_y >= TerminalBuffer::GetRows())
+    {
+        TerminalBuffer::ScrollUp();
+        s_cursor_y = TerminalBuffer::GetRows() - 1;
+    }
+}
 
-    for (const char* p = buffer; *p; p++)
+/** Copy text into the base grid a row-sized run at a time; '\n' starts a new line, '\r' returns to column 0 (progress lines), wrap happens before the next char. */
+static void WriteSpan(const char* text, size_t length)
+{
+    int cols = TerminalBuffer::GetCols();
+    const char* p = text;
+    const char* end = text + length;
+    const char* nextReturn = (const char*)memchr(p, '\r', length);
+    while (p < end)
     {
         if (*p == '\n')
         {
-            s_cursor_x = 0;
-            s_cursor_y++;
-            if (s_cursor_y >= GetRows())
-            {
-                ScrollUp();
-                s_cursor_y = GetRows() - 1;
-            }
+            NewLine();
+            p++;
             continue;
         }
-
-        if (s_cursor_x >= GetCols())
+        if (*p == '\r')
         {
             s_cursor_x = 0;
-            s_cursor_y++;
-            if (s_cursor_y >= GetRows())
-            {
-                ScrollUp();
-                s_cursor_y = GetRows() - 1;
-            }
+            p++;
+            nextReturn = (const char*)memchr(p, '\r', (size_t)(end - p));
+            continue;
         }
 
-        if (s_cursor_y >= 0 && s_cursor_y < GetRows() && s_cursor_x >= 0 && s_cursor_x < GetCols())
+        const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+        const char* runEnd = (newline != NULL) ? newline : end;
+        if (nextReturn != NULL && nextReturn < runEnd)
         {
-            s_baseBuffer[(s_cursor_y * GetCols()) + s_cursor_x] = *p;
+            runEnd = nextReturn;
+        }
+        while (p < runEnd)
+        {
+            if (s_cursor_x >= cols)
+            {
+                NewLine();
+            }
+            int count = cols - s_cursor_x;
+            if ((int)(runEnd - p) < count)
+            {
+                count = (int)(runEnd - p);
+            }
+            memcpy(BaseRow(s_cursor_y) + s_cursor_x, p, (size_t)count);
+            memset(BaseAttrRow(s_cursor_y) + s_cursor_x, s_writeAttr, (size_t)count);
+            MarkBaseRowDirty(s_cursor_y);
+            s_cursor_x += count;
+            p += count;
         }
-        s_cursor_x++;
     }
 }
 
+void TerminalBuffer::Write(std::string message, ...)
+{
+    Init();
+
+    char buffer[1024];
+    va_list arglist;
+    va_start(arglist, message);
+    _vsnprintf(buffer, 1024, message.c_str(), arglist);
+    va_end(arglist);
+    buffer[1024 - 1] = '\0';
+
+    WriteSpan(buffer, strlen(buffer));
+}
+
 void TerminalBuffer::WriteRaw(const std::string& s)
 {
     Init();
-    for (size_t i = 0; i < s.size(); i++)
+    if (!s.empty())
     {
-        char c = s[i];
-        if (c == '\n')
-        {
-            s_cursor_x = 0;
-            s_cursor_y++;
-            if (s_cursor_y >= GetRows())
-            {
-                ScrollUp();
-                s_cursor_y = GetRows() - 1;
-            }
-            continue;
-        }
-
-        if (s_cursor_x >= GetCols())
-        {
-            s_cursor_x = 0;
-            s_cursor_y++;
-            if (s_cursor_y >= GetRows())
-            {
-                ScrollUp();
-                s_cursor_y = GetRows() - 1;
-            }
-        }
+        WriteSpan(s.data(), s.size());
+    }
+}
 
-        if (s_cursor_y >= 0 && s_cursor_y < GetRows() && s_cursor_x >= 0 && s_cursor_x < GetCols())
-        {
-            s_baseBuffer[(s_cursor_y * GetCols()) + s_cursor_x] = c;
-        }
-        s_cursor_x++;
+void TerminalBuffer::WriteRaw(const char* text, size_t length)
+{
+    Init();
+    if (length > 0)
+    {
+        WriteSpan(text, length);
     }
 }
 
@@ -196,38 +278,19 @@ void TerminalBuffer::ScrollUp()
     {
         return;
     }
-    /* Push top row of base buffer into scrollback ring */
-    int cap = TERMINAL_SCROLLBACK_MAX_ROWS;
-    int phys = (s_scrollbackStart + s_scrollbackCount) % cap;
-    int copyCols = (cols < TERMINAL_MAX_COLS) ? cols : TERMINAL_MAX_COLS;
-    for (int col = 0; col < copyCols; col++)
-    {
-        s_scrollback[phys * TERMINAL_MAX_COLS + col] = s_baseBuffer[0 * cols + col];
-    }
-    for (int col = copyCols; col < TERMINAL_MAX_COLS; col++)
-    {
-        s_scrollback[phys * TERMINAL_MAX_COLS + col] = ' ';
-    }
-    if (s_scrollbackCount >= cap)
-    {
-        s_scrollbackStart = (s_scrollbackStart + 1) % cap;
-    }
-    else
-    {
-        s_scrollbackCount++;
-    }
-    /* Shift base buffer up */
-    for (int row = 0; row < rows - 1; row++)
+    /* Push top row of base buffer into scrollback */
+    char* top = BaseRow(0);
+    unsigned char* topAttrs = BaseAttrRow(0);
+    Scrollback::PushLine(top, topAttrs, cols);
+    if (s_scrollOffset > Scrollback::GetLineCount())
     {
-        for (int col = 0; col < cols; col++)
-        {
-            s_baseBuffer[(row * cols) + col] = s_baseBuffer[((row + 1) * cols) + col];
-        }
-    }
-    for (int col = 0; col < cols; col++)
-    {
-        s_baseBuffer[((rows - 1) * cols) + col] = ' ';
+        s_scrollOffset = Scrollback::GetLineCount();
     }
+    /* Rotate the row ring: the old top row becomes the new (cleared) last row */
+    s_baseHead = (s_baseHead + 1 < rows) ? s_baseHead + 1 : 0;
+    memset(top, ' ', (size_t)cols);
+    memset(topAttrs, TERMINAL_ATTR_DEFAULT, (size_t)cols);
+    MarkAllRowsDirty();
 }
 
 void TerminalBuffer::ScrollPageUp()
@@ -238,12 +301,13 @@ void TerminalBuffer::ScrollPageUp()
     {
         return;
     }
-    int maxOffset = s_scrollbackCount;
-    s_scrollOffset += pageRows;
-    if (s_scrollOffset > maxOffset)
+    int maxOffset = Scrollback::GetLineCount();
+    int offset = s_scrollOffset + pageRows;
+    if (offset > maxOffset)
     {
-        s_scrollOffset = maxOffset;
+        offset = maxOffset;
     }
+    SetScrollOffset(offset);
 }
 
 void TerminalBuffer::ScrollPageDown()
@@ -253,73 +317,54 @@ void TerminalBuffer::ScrollPageDown()
     {
         return;
     }
-    s_scrollOffset -= pageRows;
-    if (s_scrollOffset < 0)
+    int offset = s_scrollOffset - pageRows;
+    if (offset < 0)
     {
-        s_scrollOffset = 0;
+        offset = 0;
     }
+    SetScrollOffset(offset);
 }
 
 void TerminalBuffer::ScrollToBottom()
 {
-    s_scrollOffset = 0;
+    SetScrollOffset(0);
 }
 
-static void RefreshViewBuffer()
+/** Fill one view row from the base buffer or scrollback according to the scroll offset. */
+static void FillViewRow(int r, int rows, int cols)
 {
-    int rows = TerminalBuffer::GetRows();
-    int cols = TerminalBuffer::GetCols();
-    if (s_scrollOffset == 0)
+    char* dst = &s_buffer[r * cols];
+    unsigned char* dstAttrs = &s_attrBuffer[r * cols];
+    /* Last row is always the input row from base buffer */
+    if (s_scrollOffset == 0 || r == rows - 1)
     {
-        for (int i = 0; i < rows * cols; i++)
-        {
-            s_buffer[i] = s_baseBuffer[i];
-        }
+        memcpy(dst, BaseRow(r), (size_t)cols);
+        memcpy(dstAttrs, BaseAttrRow(r), (size_t)cols);
         return;
     }
-    int cap = TERMINAL_SCROLLBACK_MAX_ROWS;
-    /* Top scrollOffset rows from scrollback (newest first) */
-    for (int r = 0; r < s_scrollOffset && r < rows; r++)
+    if (r >= s_scrollOffset)
     {
-        int logical = s_scrollbackCount - s_scrollOffset + r;
-        if (logical < 0)
-        {
-            for (int col = 0; col < cols; col++)
-            {
-                s_buffer[(r * cols) + col] = ' ';
-            }
-        }
-        else
-        {
-            int phys = (s_scrollbackStart + logical) % cap;
-            int copyCols = (cols < TERMINAL_MAX_COLS) ? cols : TERMINAL_MAX_COLS;
-            for (int col = 0; col < copyCols; col++)
-            {
-                s_buffer[(r * cols) + col] = s_scrollback[phys * TERMINAL_MAX_COLS + col];
-            }
-            for (int col = copyCols; col < cols; col++)
-            {
-                s_buffer[(r * cols) + col] = ' ';
-            }
-        }
+        /* Content rows from base buffer (rows 0..rows-2) */
+        memcpy(dst, BaseRow(r - s_scrollOffset), (size_t)cols);
+        memcpy(dstAttrs, BaseAttrRow(r - s_scrollOffset), (size_t)cols);
+        return;
     }
-    /* Content rows from base buffer (rows 0..rows-2), then input row (rows-1) */
-    int contentFromBase = rows - 1 - s_scrollOffset;
-    if (contentFromBase > 0)
+    /* Top scrollOffset rows from scrollback (newest first) */
+    Scrollback::CopyLine(Scrollback::GetLineCount() - s_scrollOffset + r, dst, dstAttrs, cols);
+}
+
+/** Copy only the view rows marked dirty since the last ClearDirtyRows. */
+static void RefreshViewBuffer()
+{
+    int rows = TerminalBuffer::GetRows();
+    int cols = TerminalBuffer::GetCols();
+    for (int r = 0; r < rows && r < TERMINAL_MAX_ROWS; r++)
     {
-        for (int r = 0; r < contentFromBase; r++)
+        if ((s_dirtyRows[r >> 5] & (1u << (r & 31))) != 0)
         {
-            for (int col = 0; col < cols; col++)
-            {
-                s_buffer[(s_scrollOffset + r) * cols + col] = s_baseBuffer[r * cols + col];
-            }
+            FillViewRow(r, rows, cols);
         }
     }
-    /* Last row is always the input row from base buffer */
-    for (int col = 0; col < cols; col++)
-    {
-        s_buffer[(rows - 1) * cols + col] = s_baseBuffer[(rows - 1) * cols + col];
-    }
 }
 
 const char* TerminalBuffer::GetBuffer()
@@ -329,6 +374,40 @@ const char* TerminalBuffer::GetBuffer()
     return s_buffer;
 }
 
+const unsigned char* TerminalBuffer::GetAttributes()
+{
+    Init();
+    RefreshViewBuffer();
+    return s_attrBuffer;
+}
+
+const uint32_t* TerminalBuffer::GetDirtyRows()
+{
+    return s_dirtyRows;
+}
+
+bool TerminalBuffer::HasDirtyRows()
+{
+    for (int i = 0; i < TERMINAL_DIRTY_WORDS; i++)
+    {
+        if (s_dirtyRows[i] != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TerminalBuffer::ClearDirtyRows()
+{
+    memset(s_dirtyRows, 0, sizeof(s_dirtyRows));
+}
+
+void TerminalBuffer::MarkAllRowsDirty()
+{
+    memset(s_dirtyRows, 0xFF, sizeof(s_dirtyRows));
+}
+
 int TerminalBuffer::GetCols()
 {
     return Drawing::GetBufferWidth() / TERMINAL_FONT_SIZE_WIDTH;
@@ -492,10 +571,22 @@ void TerminalBuffer::UpdateInputRow()
     }
     int inputRow = rows - 1;
     std::string line = s_prompt + s_inputLine;
+    char* inputChars = BaseRow(inputRow);
+    unsigned char* inputAttrs = BaseAttrRow(inputRow);
+    bool changed = false;
     for (int col = 0; col < cols; col++)
     {
         char ch = (col < (int)line.length()) ? line[col] : ' ';
-        s_baseBuffer[(inputRow * cols) + col] = ch;
+        if (inputChars[col] != ch || inputAttrs[col] != TERMINAL_ATTR_DEFAULT)
+        {
+            inputChars[col] = ch;
+            inputAttrs[col] = TERMINAL_ATTR_DEFAULT;
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        MarkBaseRowDirty(inputRow);
     }
 }
 
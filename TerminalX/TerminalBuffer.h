@@ -8,9 +8,16 @@
 #define TERMINAL_FONT_SIZE_HEIGHT 16
 #define TERMINAL_MAX_COLS 255
 #define TERMINAL_MAX_ROWS 255
-#define TERMINAL_MAX_VERTS (TERMINAL_MAX_ROWS * TERMINAL_MAX_COLS * 6)
-/** Max scrollback lines (for TYPE 64K and Page Up/Down) */
-#define TERMINAL_SCROLLBACK_MAX_ROWS 1024
+/** Max scrollback lines (for TYPE and Page Up/Down); the byte budget below holds about 5900 40-column lines, so this cap only binds on shorter ones */
+#define TERMINAL_SCROLLBACK_MAX_ROWS 8192
+/** Memory budget for scrollback chunks; oldest lines are dropped first when it is used up */
+#define TERMINAL_SCROLLBACK_MAX_BYTES (256 * 1024)
+/** Cell attribute that follows the current COLOR setting; any other value is a fixed COLOR-style attribute byte */
+#define TERMINAL_ATTR_DEFAULT 0x00
+/** Cell attribute with foreground fg (1-F) over whatever background COLOR has when drawn; COLOR rejects equal nibbles, so no fixed attribute looks like this */
+#define TERMINAL_ATTR_FOREGROUND(fg) ((unsigned char)(((fg) << 4) | (fg)))
+/** Words in the per-row dirty bitmap (one bit per visible row) */
+#define TERMINAL_DIRTY_WORDS ((TERMINAL_MAX_ROWS + 31) / 32)
 
 class TerminalBuffer
 {
@@ -21,6 +28,7 @@ public:
     static void Write(std::string message, ...);
     /** Write a string in full (no 1024-char limit). Use for command output (e.g. TYPE). */
     static void WriteRaw(const std::string& s);
+    static void WriteRaw(const char* text, size_t length);
     static void ScrollUp();
     /** Page Up / Page Down scrollback. Call when user presses those keys. */
     static void ScrollPageUp();
@@ -28,6 +36,14 @@ public:
     /** Scroll to bottom (e.g. when user starts typing). */
     static void ScrollToBottom();
     static const char* GetBuffer();
+    /** Attribute plane parallel to GetBuffer (one byte per cell, TERMINAL_ATTR_DEFAULT = current COLOR). */
+    static const unsigned char* GetAttributes();
+    /** Bitmap of visible rows changed since ClearDirtyRows (bit r%32 of word r/32). Pass to Drawing::DrawTerminal. */
+    static const uint32_t* GetDirtyRows();
+    static bool HasDirtyRows();
+    static void ClearDirtyRows();
+    /** Force a full redraw (e.g. after another screen such as EDIT used the display). */
+    static void MarkAllRowsDirty();
     static int GetCols();
     static int GetRows();
     static int GetCursorX();
@@ -57,6 +73,11 @@ public:
     static void SetColorAttribute(unsigned char attr);
     static void ResetColorAttribute();
     static unsigned char GetColorAttribute();
+    /** Attribute stored with subsequent Write/WriteRaw output (TERMINAL_ATTR_DEFAULT = follow COLOR). */
+    static void SetWriteAttribute(unsigned char attr);
+    static unsigned char GetWriteAttribute();
+    /** ARGB color for a 4-bit palette index (one nibble of an attribute byte). */
+    static unsigned int GetPaletteColor(int index);
     static unsigned int GetTextColor();
     static unsigned int GetBackgroundColor();
 };
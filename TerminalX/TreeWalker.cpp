@@ -0,0 +1,207 @@
+#include "TreeWalker.h"
+#include "DirEnumerator.h"
+
+#define TREE_WALKER_MAX_QUEUED 64
+#define TREE_WALKER_STACK_SIZE (64 * 1024)
+
+TreeWalker::TreeWalker()
+    : mRecursive(false), mThread(NULL), mReady(NULL), mSpace(NULL), mFinished(true), mStopping(false), mFailedDirs(0)
+{
+    InitializeCriticalSection(&mLock);
+}
+
+TreeWalker::~TreeWalker()
+{
+    Stop();
+    DeleteCriticalSection(&mLock);
+}
+
+bool TreeWalker::Start(const std::string& rootApi, bool recursive)
+{
+    Stop();
+    mRoot = rootApi;
+    mRecursive = recursive;
+    mFinished = false;
+    mStopping = false;
+    mFailedDirs = 0;
+    mReady = CreateEvent(NULL, FALSE, FALSE, NULL);
+    mSpace = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (mReady != NULL && mSpace != NULL)
+    {
+        mThread = CreateThread(NULL, TREE_WALKER_STACK_SIZE, ThreadProc, this, 0, NULL);
+    }
+    if (mThread == NULL)
+    {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+DWORD WINAPI TreeWalker::ThreadProc(LPVOID param)
+{
+    ((TreeWalker*)param)->Walk();
+    return 0;
+}
+
+void TreeWalker::Walk()
+{
+    /* Depth-first with an explicit stack of relative paths; subdirectories are pushed in reverse so they come out in listing order */
+    std::vector<std::string> pending;
+    pending.push_back("");
+    DirEnumerator dirEnum;
+    DirEnumEntry entry;
+    while (!pending.empty())
+    {
+        TreeBatch* batch = new TreeBatch;
+        batch->relativeDir = pending.back();
+        pending.pop_back();
+
+        std::string apiDir = mRoot;
+        if (!batch->relativeDir.empty())
+        {
+            if (apiDir.length() > 0 && apiDir[apiDir.length() - 1] != '\\')
+            {
+                apiDir += "\\";
+            }
+            apiDir += batch->relativeDir;
+        }
+        if (dirEnum.Open(apiDir))
+        {
+            while (dirEnum.Next(entry))
+            {
+                if (entry.isDir)
+                {
+                    batch->subdirs.push_back(std::string(entry.name, entry.nameLength));
+                    continue;
+                }
+                TreeFile file;
+                file.name.assign(entry.name, entry.nameLength);
+                file.size = entry.size;
+                file.attributes = entry.attributes;
+                batch->files.push_back(file);
+            }
+            dirEnum.Close();
+        }
+        else
+        {
+            EnterCriticalSection(&mLock);
+            mFailedDirs++;
+            LeaveCriticalSection(&mLock);
+        }
+
+        if (mRecursive)
+        {
+            for (size_t i = batch->subdirs.size(); i > 0; i--)
+            {
+                const std::string& name = batch->subdirs[i - 1];
+                pending.push_back(batch->relativeDir.empty() ? name : batch->relativeDir + "\\" + name);
+            }
+        }
+        if (!Push(batch))
+        {
+            break;
+        }
+    }
+
+    EnterCriticalSection(&mLock);
+    mFinished = true;
+    LeaveCriticalSection(&mLock);
+    SetEvent(mReady);
+}
+
+bool TreeWalker::Push(TreeBatch* batch)
+{
+    EnterCriticalSection(&mLock);
+    while (mQueue.size() >= TREE_WALKER_MAX_QUEUED && !mStopping)
+    {
+        LeaveCriticalSection(&mLock);
+        WaitForSingleObject(mSpace, INFINITE);
+        EnterCriticalSection(&mLock);
+    }
+    if (mStopping)
+    {
+        LeaveCriticalSection(&mLock);
+        delete batch;
+        return false;
+    }
+    mQueue.push_back(batch);
+    LeaveCriticalSection(&mLock);
+    SetEvent(mReady);
+    return true;
+}
+
+TreeBatch* TreeWalker::Pop(bool wait)
+{
+    if (mThread == NULL)
+    {
+        return NULL;
+    }
+    for (;;)
+    {
+        EnterCriticalSection(&mLock);
+        if (!mQueue.empty())
+        {
+            TreeBatch* batch = mQueue.front();
+            mQueue.pop_front();
+            LeaveCriticalSection(&mLock);
+            SetEvent(mSpace);
+            return batch;
+        }
+        bool finished = mFinished;
+        LeaveCriticalSection(&mLock);
+        if (finished || !wait)
+        {
+            return NULL;
+        }
+        WaitForSingleObject(mReady, INFINITE);
+    }
+}
+
+TreeBatch* TreeWalker::Next()
+{
+    return Pop(true);
+}
+
+TreeBatch* TreeWalker::TryNext()
+{
+    return Pop(false);
+}
+
+void TreeWalker::Stop()
+{
+    if (mThread != NULL)
+    {
+        EnterCriticalSection(&mLock);
+        mStopping = true;
+        LeaveCriticalSection(&mLock);
+        SetEvent(mSpace);
+        WaitForSingleObject(mThread, INFINITE);
+        CloseHandle(mThread);
+        mThread = NULL;
+    }
+    while (!mQueue.empty())
+    {
+        delete mQueue.front();
+        mQueue.pop_front();
+    }
+    if (mReady != NULL)
+    {
+        CloseHandle(mReady);
+        mReady = NULL;
+    }
+    if (mSpace != NULL)
+    {
+        CloseHandle(mSpace);
+        mSpace = NULL;
+    }
+    mFinished = true;
+}
+
+unsigned int TreeWalker::GetFailedDirCount() const
+{
+    EnterCriticalSection(&mLock);
+    unsigned int failed = mFailedDirs;
+    LeaveCriticalSection(&mLock);
+    return failed;
+}
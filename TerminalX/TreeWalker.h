@@ -0,0 +1,62 @@
+#pragma once
+
+#include "External.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/** One file found by TreeWalker. */
+struct TreeFile
+{
+    std::string name;
+    unsigned __int64 size;
+    DWORD attributes;
+};
+
+/** The contents of one directory; relativeDir is "" for the root, else e.g. "saves\\ABCD0001". */
+struct TreeBatch
+{
+    std::string relativeDir;
+    std::vector<TreeFile> files;
+    std::vector<std::string> subdirs;
+};
+
+/** Enumerates a directory tree on a worker thread, handing out one TreeBatch per directory (parents before children) so the caller can work on one directory while the next is listed. At most TREE_WALKER_MAX_QUEUED batches wait in the queue. */
+class TreeWalker
+{
+public:
+    TreeWalker();
+    ~TreeWalker();
+
+    /** Start listing rootApi (e.g. "HDD0-E:\Games"); recursive=false lists only the root. Returns false if the thread cannot be started. */
+    bool Start(const std::string& rootApi, bool recursive);
+    /** Wait for the next batch; returns NULL once the walk is finished. The caller deletes the batch. */
+    TreeBatch* Next();
+    /** Like Next, but returns NULL at once if no batch is queued yet. */
+    TreeBatch* TryNext();
+    /** Stop the worker early and discard queued batches. */
+    void Stop();
+    /** Number of directories that could not be listed. */
+    unsigned int GetFailedDirCount() const;
+
+private:
+    TreeWalker(const TreeWalker&);
+    TreeWalker& operator=(const TreeWalker&);
+
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void Walk();
+    bool Push(TreeBatch* batch);
+    TreeBatch* Pop(bool wait);
+
+    std::string mRoot;
+    bool mRecursive;
+    HANDLE mThread;
+    HANDLE mReady;           /* signalled when a batch is queued or the walk ends */
+    HANDLE mSpace;           /* signalled when a batch is taken or Stop is called */
+    mutable CRITICAL_SECTION mLock;
+    std::deque<TreeBatch*> mQueue;
+    bool mFinished;
+    bool mStopping;
+    unsigned int mFailedDirs;
+};
@@ -0,0 +1,161 @@
+#include "Wildcard.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#define WILDCARD_NAME_BUFFER 256
+
+Wildcard::Wildcard()
+    : mHasStar(true), mMinLength(0), mAnyName(true)
+{
+}
+
+Wildcard::Wildcard(const std::string& pattern)
+{
+    Compile(pattern);
+}
+
+bool Wildcard::HasWildcards(const std::string& text)
+{
+    return text.find_first_of("*?") != std::string::npos;
+}
+
+void Wildcard::Compile(const std::string& pattern)
+{
+    std::string upper = pattern;
+    for (size_t i = 0; i < upper.length(); i++)
+    {
+        upper[i] = (char)toupper((unsigned char)upper[i]);
+    }
+    mPrefix.clear();
+    mSuffix.clear();
+    mMiddle.clear();
+
+    size_t firstStar = upper.find('*');
+    mHasStar = (firstStar != std::string::npos);
+    if (!mHasStar)
+    {
+        mPrefix = upper;
+        mMinLength = upper.length();
+        mAnyName = false;
+        return;
+    }
+
+    /* "AB*CD*?E*FG" -> prefix "AB", middle {"CD", "?E"}, suffix "FG"; runs of stars collapse */
+    size_t lastStar = upper.rfind('*');
+    mPrefix = upper.substr(0, firstStar);
+    mSuffix = upper.substr(lastStar + 1);
+    mMinLength = mPrefix.length() + mSuffix.length();
+    std::string segment;
+    for (size_t i = firstStar + 1; i <= lastStar; i++)
+    {
+        if (upper[i] != '*')
+        {
+            segment += upper[i];
+            continue;
+        }
+        if (!segment.empty())
+        {
+            mMinLength += segment.length();
+            mMiddle.push_back(segment);
+            segment.clear();
+        }
+    }
+    mAnyName = (mMinLength == 0);
+}
+
+bool Wildcard::MatchAt(const char* text, const std::string& literal)
+{
+    for (size_t i = 0; i < literal.length(); i++)
+    {
+        if (literal[i] != '?' && literal[i] != text[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* Wildcard::Find(const char* text, const char* end, const std::string& literal)
+{
+    size_t length = literal.length();
+    if ((size_t)(end - text) < length)
+    {
+        return NULL;
+    }
+    /* memchr to the first fixed character of the segment, then confirm the rest in place */
+    size_t anchor = literal.find_first_not_of('?');
+    if (anchor == std::string::npos)
+    {
+        return text;
+    }
+    const char* lastStart = end - length;
+    char c = literal[anchor];
+    while (text <= lastStart)
+    {
+        const char* hit = (const char*)memchr(text + anchor, c, (size_t)(lastStart - text) + 1);
+        if (hit == NULL)
+        {
+            return NULL;
+        }
+        text = hit - anchor;
+        if (MatchAt(text, literal))
+        {
+            return text;
+        }
+        text++;
+    }
+    return NULL;
+}
+
+bool Wildcard::Matches(const std::string& name) const
+{
+    return Matches(name.data(), name.length());
+}
+
+bool Wildcard::Matches(const char* name, size_t length) const
+{
+    if (length < mMinLength)
+    {
+        return false;
+    }
+    if (mAnyName)
+    {
+        return true;
+    }
+
+    char buffer[WILDCARD_NAME_BUFFER];
+    std::string longName;
+    char* upper = buffer;
+    if (length > sizeof(buffer))
+    {
+        longName.resize(length);
+        upper = &longName[0];
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        upper[i] = (char)toupper((unsigned char)name[i]);
+    }
+
+    if (!mHasStar)
+    {
+        return length == mPrefix.length() && MatchAt(upper, mPrefix);
+    }
+    const char* tail = upper + length - mSuffix.length();
+    if (!MatchAt(upper, mPrefix) || !MatchAt(tail, mSuffix))
+    {
+        return false;
+    }
+    /* Taking the leftmost hit of each middle segment never loses a match, so there is no backtracking */
+    const char* p = upper + mPrefix.length();
+    for (size_t i = 0; i < mMiddle.size(); i++)
+    {
+        const char* hit = Find(p, tail, mMiddle[i]);
+        if (hit == NULL)
+        {
+            return false;
+        }
+        p = hit + mMiddle[i].length();
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/** A DOS wildcard pattern ('*' = any run, '?' = any one character, case-insensitive), compiled once and then matched without recursion or backtracking across stars. */
+class Wildcard
+{
+public:
+    Wildcard();
+    explicit Wildcard(const std::string& pattern);
+
+    void Compile(const std::string& pattern);
+    bool Matches(const char* name, size_t length) const;
+    bool Matches(const std::string& name) const;
+
+    /** True if text contains '*' or '?'. */
+    static bool HasWildcards(const std::string& text);
+
+private:
+    static bool MatchAt(const char* text, const std::string& literal);
+    static const char* Find(const char* text, const char* end, const std::string& literal);
+
+    bool mHasStar;
+    std::string mPrefix;                /* upper-cased text before the first '*' (the whole pattern if there is none) */
+    std::string mSuffix;                /* upper-cased text after the last '*' */
+    std::vector<std::string> mMiddle;   /* non-empty segments between stars, searched for left to right */
+    size_t mMinLength;                  /* characters any match needs */
+    bool mAnyName;                      /* pattern is only stars */
+};